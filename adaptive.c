@@ -0,0 +1,72 @@
+#include <inttypes.h>
+#include <math.h>
+#include <string.h>
+
+#include <adaptive.h>
+#include <stat_eval.h>
+
+void
+adaptive_init(adaptive_t *adaptive,
+	      double target,
+	      double budget,
+	      uint32_t batch) {
+	memset(adaptive, 0, sizeof(adaptive_t));
+	adaptive->target = target;
+	adaptive->budget = budget;
+	adaptive->batch = batch ? batch : ADAPTIVE_DEFAULT_BATCH;
+}
+
+/* call at the beginning of each measurement */
+void
+adaptive_start(adaptive_t *adaptive) {
+	adaptive->start = MPI_Wtime();
+	adaptive->width = INFINITY;
+	adaptive->converged = false;
+}
+
+/*
+ * Call after every round with the number of completed 'rounds' (the same on
+ * all ranks of 'comm'); ranks without samples pass none. Communicates only
+ * every 'batch' rounds and returns true once the measurement may stop.
+ */
+bool
+adaptive_check(adaptive_t *adaptive,
+	       MPI_Comm comm,
+	       uint64_t rounds,
+	       const double *samples,
+	       uint64_t num_samples) {
+	double median, lower, upper;
+	double vals[2] = { 0, 0 };
+
+	if (rounds % adaptive->batch)
+		return false;
+
+	if (num_samples) {
+		if (stat_eval_median_ci(samples, num_samples,
+					ADAPTIVE_CONFIDENCE, &median, &lower,
+					&upper) || !(median > 0))
+			vals[0] = INFINITY;
+		else
+			vals[0] = (upper-lower)/median*100;
+	}
+	vals[1] = MPI_Wtime()-adaptive->start;
+	MPI_Allreduce(MPI_IN_PLACE, vals, 2, MPI_DOUBLE, MPI_MAX, comm);
+
+	adaptive->width = vals[0];
+	adaptive->converged = (vals[0] <= adaptive->target);
+
+	return adaptive->converged ||
+	    ((adaptive->budget > 0) && (vals[1] >= adaptive->budget));
+}
+
+/* outcome of the last measurement that took 'rounds' rounds */
+void
+adaptive_print(const adaptive_t *adaptive,
+	       uint64_t rounds,
+	       FILE *output) {
+	fprintf(output, "#Adaptive      %s after %" PRIu64 " rounds "
+		"(%d%% CI of the median: %.2f%%, target %.2f%%)\n",
+		adaptive->converged ? "converged" : "not converged",
+		rounds, ADAPTIVE_CONFIDENCE, adaptive->width,
+		adaptive->target);
+}
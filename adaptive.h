@@ -0,0 +1,50 @@
+#ifndef _ADAPTIVE_H
+#define _ADAPTIVE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <mpi.h>
+
+/*
+ * Adaptive number of rounds: a measurement runs in batches of rounds and
+ * stops as soon as the confidence interval of the median is narrower than
+ * 'target' percent of the median on every rank with samples, once 'budget'
+ * seconds have passed, or at the maximum number of rounds. The check after
+ * each batch is collective, so all ranks stop after the same round.
+ */
+#define ADAPTIVE_DEFAULT_BATCH		(100)
+#define ADAPTIVE_CONFIDENCE		(95)	/* percent */
+
+typedef struct _adaptive_t {
+	double target;		/* relative CI width in percent */
+	double budget;		/* seconds per measurement, 0: unlimited */
+	uint32_t batch;		/* rounds between two checks */
+	double start;
+	double width;		/* widest relative CI at the last check */
+	bool converged;
+} adaptive_t;
+
+void
+adaptive_init(adaptive_t *adaptive,
+	      double target,
+	      double budget,
+	      uint32_t batch);
+
+void
+adaptive_start(adaptive_t *adaptive);
+
+bool
+adaptive_check(adaptive_t *adaptive,
+	       MPI_Comm comm,
+	       uint64_t rounds,
+	       const double *samples,
+	       uint64_t num_samples);
+
+void
+adaptive_print(const adaptive_t *adaptive,
+	       uint64_t rounds,
+	       FILE *output);
+
+#endif /* _ADAPTIVE_H */
@@ -0,0 +1,288 @@
+#include <stddef.h>
+
+#include <bcast.h>
+
+/* ranks are numbered relative to the root */
+static inline int
+real_rank(int vrank,
+	  int root,
+	  int size) {
+	return (vrank+root)%size;
+}
+
+/* elements per pipeline segment */
+static inline int
+segment_count(int segment,
+	      int type_size) {
+	int count = type_size ? segment/type_size : segment;
+
+	return (count > 0) ? count : 1;
+}
+
+/* offset and length (in elements) of the blocks [first, last) */
+static inline void
+block_range(int first,
+	    int last,
+	    int block,
+	    int count,
+	    int *offset,
+	    int *len) {
+	long lo = (long)first*block;
+	long hi = (long)last*block;
+
+	if (lo > count)
+		lo = count;
+	if (hi > count)
+		hi = count;
+	*offset = lo;
+	*len = hi-lo;
+}
+
+int
+bcast_binomial(void *buf,
+	       int count,
+	       MPI_Datatype type,
+	       int root,
+	       MPI_Comm comm) {
+	int rank, size, vrank, mask;
+
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &size);
+	if ((count == 0) || (size == 1))
+		return MPI_SUCCESS;
+	vrank = (rank-root+size)%size;
+
+	/* the parent differs in the lowest set bit */
+	for (mask=1; mask<size; mask<<=1) {
+		if (vrank & mask) {
+			MPI_Recv(buf, count, type,
+				 real_rank(vrank-mask, root, size), BCAST_TAG,
+				 comm, MPI_STATUS_IGNORE);
+			break;
+		}
+	}
+
+	/* the largest subtree first */
+	for (mask>>=1; mask>0; mask>>=1) {
+		if (vrank+mask < size)
+			MPI_Send(buf, count, type,
+				 real_rank(vrank+mask, root, size), BCAST_TAG,
+				 comm);
+	}
+
+	return MPI_SUCCESS;
+}
+
+int
+bcast_chain(void *buf,
+	    int count,
+	    MPI_Datatype type,
+	    int root,
+	    MPI_Comm comm,
+	    int segment) {
+	unsigned char *ptr = (unsigned char *)buf;
+	int rank, size, vrank, type_size, seg, pos, len;
+	MPI_Request req = MPI_REQUEST_NULL;
+
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &size);
+	MPI_Type_size(type, &type_size);
+	if ((count == 0) || (size == 1))
+		return MPI_SUCCESS;
+	vrank = (rank-root+size)%size;
+	seg = segment_count(segment, type_size);
+
+	/* forwarding segment i overlaps with receiving segment i+1 */
+	for (pos=0; pos<count; pos+=seg) {
+		len = (count-pos < seg) ? count-pos : seg;
+		if (vrank > 0)
+			MPI_Recv(ptr+(size_t)pos*type_size, len, type,
+				 real_rank(vrank-1, root, size), BCAST_TAG,
+				 comm, MPI_STATUS_IGNORE);
+		if (vrank < size-1) {
+			MPI_Wait(&req, MPI_STATUS_IGNORE);
+			MPI_Isend(ptr+(size_t)pos*type_size, len, type,
+				  real_rank(vrank+1, root, size), BCAST_TAG,
+				  comm, &req);
+		}
+	}
+
+	return MPI_Wait(&req, MPI_STATUS_IGNORE);
+}
+
+int
+bcast_scatter_ring(void *buf,
+		   int count,
+		   MPI_Datatype type,
+		   int root,
+		   MPI_Comm comm) {
+	unsigned char *ptr = (unsigned char *)buf;
+	int rank, size, vrank, type_size, block, mask, i;
+	int offset, len, recv_offset, recv_len, last;
+
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &size);
+	MPI_Type_size(type, &type_size);
+	if ((count == 0) || (size == 1))
+		return MPI_SUCCESS;
+	vrank = (rank-root+size)%size;
+	block = (count+size-1)/size;
+
+	/* binomial scatter: block i ends up on relative rank i */
+	for (mask=1; mask<size; mask<<=1) {
+		if (vrank & mask) {
+			last = (vrank+mask < size) ? vrank+mask : size;
+			block_range(vrank, last, block, count, &offset, &len);
+			if (len)
+				MPI_Recv(ptr+(size_t)offset*type_size, len,
+					 type,
+					 real_rank(vrank-mask, root, size),
+					 BCAST_TAG, comm, MPI_STATUS_IGNORE);
+			break;
+		}
+	}
+	for (mask>>=1; mask>0; mask>>=1) {
+		if (vrank+mask >= size)
+			continue;
+		last = (vrank+2*mask < size) ? vrank+2*mask : size;
+		block_range(vrank+mask, last, block, count, &offset, &len);
+		if (len)
+			MPI_Send(ptr+(size_t)offset*type_size, len, type,
+				 real_rank(vrank+mask, root, size), BCAST_TAG,
+				 comm);
+	}
+
+	/* ring allgather: pass on the block received in the last step */
+	for (i=0; i<size-1; ++i) {
+		int send_block = (vrank-i+size)%size;
+		int recv_block = (vrank-i-1+size)%size;
+
+		block_range(send_block, send_block+1, block, count, &offset,
+			    &len);
+		block_range(recv_block, recv_block+1, block, count,
+			    &recv_offset, &recv_len);
+		MPI_Sendrecv(ptr+(size_t)offset*type_size, len, type,
+			     real_rank((vrank+1)%size, root, size), BCAST_TAG,
+			     ptr+(size_t)recv_offset*type_size, recv_len, type,
+			     real_rank((vrank-1+size)%size, root, size),
+			     BCAST_TAG, comm, MPI_STATUS_IGNORE);
+	}
+
+	return MPI_SUCCESS;
+}
+
+/* subtree (0: left, 1: right) of a node of the heap-ordered binary tree */
+static int
+split_subtree(int vrank) {
+	while (vrank > 2)
+		vrank = (vrank-1)/2;
+
+	return vrank-1;
+}
+
+/* the node at the same position of the other subtree on the same level */
+static int
+split_partner(int vrank) {
+	int width = 1;
+
+	while (vrank >= 2*width-1)
+		width *= 2;
+
+	/* the level holds the nodes [width-1, 2*width-1) */
+	if (vrank < width-1+width/2)
+		return vrank+width/2;
+
+	return vrank-width/2;
+}
+
+int
+bcast_split_binary(void *buf,
+		   int count,
+		   MPI_Datatype type,
+		   int root,
+		   MPI_Comm comm,
+		   int segment) {
+	unsigned char *ptr = (unsigned char *)buf;
+	int rank, size, vrank, type_size, seg, pos, len, half, i, child;
+	int half_offset[2], half_len[2];
+	MPI_Request reqs[2] = { MPI_REQUEST_NULL, MPI_REQUEST_NULL };
+
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &size);
+	MPI_Type_size(type, &type_size);
+	if ((count == 0) || (size == 1))
+		return MPI_SUCCESS;
+	vrank = (rank-root+size)%size;
+	seg = segment_count(segment, type_size);
+
+	half_offset[0] = 0;
+	half_len[0] = (count+1)/2;
+	half_offset[1] = half_len[0];
+	half_len[1] = count-half_len[0];
+
+	/* the root feeds one half into each subtree */
+	if (vrank == 0) {
+		for (pos=0; pos<half_len[0]; pos+=seg) {
+			MPI_Waitall(2, reqs, MPI_STATUSES_IGNORE);
+			for (half=0; half<2; ++half) {
+				if ((half+1 >= size) || (pos >= half_len[half]))
+					continue;
+				len = half_len[half]-pos;
+				MPI_Isend(ptr+(size_t)(half_offset[half]+pos)*
+					  type_size, (len < seg) ? len : seg,
+					  type, real_rank(half+1, root, size),
+					  BCAST_TAG, comm, &reqs[half]);
+			}
+		}
+		MPI_Waitall(2, reqs, MPI_STATUSES_IGNORE);
+
+		/* left nodes without a partner get the other half directly */
+		for (i=1; (i<size) && half_len[1]; ++i) {
+			if ((split_subtree(i) == 0) &&
+			    (split_partner(i) >= size))
+				MPI_Send(ptr+(size_t)half_offset[1]*type_size,
+					 half_len[1], type,
+					 real_rank(i, root, size), BCAST_TAG,
+					 comm);
+		}
+
+		return MPI_SUCCESS;
+	}
+
+	/* pipeline the own half down the subtree */
+	half = split_subtree(vrank);
+	for (pos=0; pos<half_len[half]; pos+=seg) {
+		len = half_len[half]-pos;
+		len = (len < seg) ? len : seg;
+		MPI_Recv(ptr+(size_t)(half_offset[half]+pos)*type_size, len,
+			 type, real_rank((vrank-1)/2, root, size), BCAST_TAG,
+			 comm, MPI_STATUS_IGNORE);
+		MPI_Waitall(2, reqs, MPI_STATUSES_IGNORE);
+		for (i=0; i<2; ++i) {
+			child = 2*vrank+1+i;
+			if (child < size)
+				MPI_Isend(ptr+(size_t)(half_offset[half]+pos)*
+					  type_size, len, type,
+					  real_rank(child, root, size),
+					  BCAST_TAG, comm, &reqs[i]);
+		}
+	}
+	MPI_Waitall(2, reqs, MPI_STATUSES_IGNORE);
+
+	/* swap the halves with the partner in the other subtree */
+	if (split_partner(vrank) < size) {
+		MPI_Sendrecv(ptr+(size_t)half_offset[half]*type_size,
+			     half_len[half], type,
+			     real_rank(split_partner(vrank), root, size),
+			     BCAST_TAG,
+			     ptr+(size_t)half_offset[1-half]*type_size,
+			     half_len[1-half], type,
+			     real_rank(split_partner(vrank), root, size),
+			     BCAST_TAG, comm, MPI_STATUS_IGNORE);
+	} else if (half_len[1]) {
+		MPI_Recv(ptr+(size_t)half_offset[1]*type_size, half_len[1],
+			 type, root, BCAST_TAG, comm, MPI_STATUS_IGNORE);
+	}
+
+	return MPI_SUCCESS;
+}
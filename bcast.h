@@ -0,0 +1,52 @@
+#ifndef _BCAST_H
+#define _BCAST_H
+
+#include <mpi.h>
+
+/*
+ * Broadcast algorithms built on point-to-point messages, to be compared
+ * against the library's MPI_Bcast():
+ *   - binomial:     binomial tree, the whole message per edge
+ *   - chain:        pipeline through all ranks in segments
+ *   - scatter_ring: binomial scatter of one block per rank followed by a
+ *                   ring allgather (van de Geijn)
+ *   - split_binary: each half of the message travels down one subtree of
+ *                   a binary tree in segments; the halves are exchanged
+ *                   between partners of both subtrees afterwards
+ * The functions take the arguments of MPI_Bcast() for contiguous basic
+ * datatypes; 'segment' is the pipeline segment size in bytes.
+ */
+#define BCAST_DEFAULT_SEGMENT	(8192)
+#define BCAST_TAG		(4242)
+
+int
+bcast_binomial(void *buf,
+	       int count,
+	       MPI_Datatype type,
+	       int root,
+	       MPI_Comm comm);
+
+int
+bcast_chain(void *buf,
+	    int count,
+	    MPI_Datatype type,
+	    int root,
+	    MPI_Comm comm,
+	    int segment);
+
+int
+bcast_scatter_ring(void *buf,
+		   int count,
+		   MPI_Datatype type,
+		   int root,
+		   MPI_Comm comm);
+
+int
+bcast_split_binary(void *buf,
+		   int count,
+		   MPI_Datatype type,
+		   int root,
+		   MPI_Comm comm,
+		   int segment);
+
+#endif /* _BCAST_H */
@@ -0,0 +1,124 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include <mpi.h>
+
+#include <buffer.h>
+
+static const char *buffer_names[BUFFER_NUM_KINDS] = {
+	"malloc", "hugetlb", "thp", "mpi"
+};
+
+/* translate an allocation kind given on the command line */
+int
+buffer_parse(const char *name,
+	     buffer_kind_t *kind) {
+	int i;
+
+	for (i=0; i<BUFFER_NUM_KINDS; ++i) {
+		if (strcmp(name, buffer_names[i]) == 0) {
+			*kind = (buffer_kind_t)i;
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+const char *
+buffer_name(buffer_kind_t kind) {
+	return (kind < BUFFER_NUM_KINDS) ? buffer_names[kind] : "unknown";
+}
+
+/* 
+ * allocate 'length' usable bytes; returns -1 if the kind of memory is not
+ * available (e.g., no huge pages reserved) or the alignment is invalid
+ */
+int
+buffer_alloc(buffer_t *buffer,
+	     size_t length,
+	     size_t alignment,
+	     size_t offset,
+	     buffer_kind_t kind) {
+	uintptr_t start;
+
+	memset(buffer, 0, sizeof(buffer_t));
+
+	/* the alignment has to be a power of two */
+	if ((alignment == 0) || (alignment & (alignment-1)))
+		return -1;
+
+	buffer->kind = kind;
+	buffer->alignment = alignment;
+	buffer->offset = offset;
+	buffer->length = length;
+	buffer->size = length+alignment+offset+1;
+
+	switch (kind) {
+		case BUFFER_MALLOC:
+			if (posix_memalign(&buffer->base,
+			    alignment < sizeof(void*) ? sizeof(void*)
+						      : alignment,
+			    buffer->size))
+				buffer->base = NULL;
+			break;
+		case BUFFER_HUGETLB:
+			buffer->size = (buffer->size+BUFFER_HUGEPAGE_SIZE-1) &
+			    ~((size_t)BUFFER_HUGEPAGE_SIZE-1);
+			buffer->base = mmap(NULL, buffer->size, 
+			    PROT_READ | PROT_WRITE,
+			    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+			if (buffer->base == MAP_FAILED)
+				buffer->base = NULL;
+			break;
+		case BUFFER_THP:
+			buffer->size = (buffer->size+BUFFER_HUGEPAGE_SIZE-1) &
+			    ~((size_t)BUFFER_HUGEPAGE_SIZE-1);
+			if (posix_memalign(&buffer->base, BUFFER_HUGEPAGE_SIZE,
+			    buffer->size)) {
+				buffer->base = NULL;
+				break;
+			}
+			madvise(buffer->base, buffer->size, MADV_HUGEPAGE);
+			break;
+		case BUFFER_MPI:
+			if (MPI_Alloc_mem(buffer->size, MPI_INFO_NULL, 
+			    &buffer->base) != MPI_SUCCESS)
+				buffer->base = NULL;
+			break;
+		default:
+			break;
+	}
+
+	if (buffer->base == NULL)
+		return -1;
+
+	/* touch the memory here, not within the first measurement */
+	memset(buffer->base, 0, buffer->size);
+
+	start = ((uintptr_t)buffer->base+alignment-1) &
+		~(uintptr_t)(alignment-1);
+	buffer->ptr = (unsigned char *)(start+offset);
+
+	return 0;
+}
+
+void
+buffer_free(buffer_t *buffer) {
+	if (buffer->base == NULL)
+		return;
+
+	switch (buffer->kind) {
+		case BUFFER_HUGETLB:
+			munmap(buffer->base, buffer->size);
+			break;
+		case BUFFER_MPI:
+			MPI_Free_mem(buffer->base);
+			break;
+		default:
+			free(buffer->base);
+			break;
+	}
+	memset(buffer, 0, sizeof(buffer_t));
+}
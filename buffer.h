@@ -0,0 +1,50 @@
+#ifndef _BUFFER_H
+#define _BUFFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Runtime-sized message buffers. The usable region starts 'offset' bytes
+ * behind an 'alignment'-aligned address so that misaligned transfers can be
+ * measured as well.
+ */
+#define BUFFER_DEFAULT_ALIGN	(4096)
+#define BUFFER_HUGEPAGE_SIZE	(2*1024*1024)
+
+typedef enum _buffer_kind_t {
+	BUFFER_MALLOC = 0,	/* posix_memalign() */
+	BUFFER_HUGETLB,		/* mmap() with MAP_HUGETLB */
+	BUFFER_THP,		/* madvise(MADV_HUGEPAGE), transparent */
+	BUFFER_MPI,		/* MPI_Alloc_mem() */
+	BUFFER_NUM_KINDS
+} buffer_kind_t;
+
+typedef struct _buffer_t {
+	buffer_kind_t kind;
+	void *base;		/* start of the allocation */
+	size_t size;		/* size of the allocation */
+	unsigned char *ptr;	/* aligned start plus offset */
+	size_t length;		/* usable bytes behind 'ptr' */
+	size_t alignment;
+	size_t offset;
+} buffer_t;
+
+int
+buffer_parse(const char *name,
+	     buffer_kind_t *kind);
+
+const char *
+buffer_name(buffer_kind_t kind);
+
+int
+buffer_alloc(buffer_t *buffer,
+	     size_t length,
+	     size_t alignment,
+	     size_t offset,
+	     buffer_kind_t kind);
+
+void
+buffer_free(buffer_t *buffer);
+
+#endif /* _BUFFER_H */
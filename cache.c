@@ -0,0 +1,163 @@
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <cache.h>
+
+static const char *cache_names[CACHE_NUM_MODES] = {
+	"warm", "cold", "rotate"
+};
+
+/* keeps the warm-up reads from being optimized away */
+static volatile unsigned char cache_dummy = 0;
+
+/* translate a cache mode given on the command line */
+int
+cache_parse(const char *name,
+	    cache_mode_t *mode) {
+	int i;
+
+	for (i=0; i<CACHE_NUM_MODES; ++i) {
+		if (strcmp(name, cache_names[i]) == 0) {
+			*mode = (cache_mode_t)i;
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+const char *
+cache_name(cache_mode_t mode) {
+	return (mode < CACHE_NUM_MODES) ? cache_names[mode] : "unknown";
+}
+
+/* size of the largest cache the C library knows about */
+size_t
+cache_llc_size(void) {
+	long size = -1;
+
+#ifdef _SC_LEVEL3_CACHE_SIZE
+	size = sysconf(_SC_LEVEL3_CACHE_SIZE);
+#endif
+#ifdef _SC_LEVEL2_CACHE_SIZE
+	if (size <= 0)
+		size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+
+	return (size > 0) ? (size_t)size : CACHE_DEFAULT_LLC;
+}
+
+static void
+touch(const unsigned char *buf,
+      size_t length) {
+	unsigned char sum = 0;
+	size_t i;
+
+	for (i=0; i<length; i+=CACHE_LINE_SIZE)
+		sum += buf[i];
+	cache_dummy += sum;
+}
+
+/*
+ * Prepare the cache state 'mode' for messages of 'length' bytes in 'send'
+ * and 'recv'. Pools default to twice the last-level cache and are allocated
+ * like the buffer 'like' (kind, alignment and offset).
+ */
+int
+cache_setup(cache_t *cache,
+	    cache_mode_t mode,
+	    unsigned char *send,
+	    unsigned char *recv,
+	    size_t length,
+	    size_t pool_size,
+	    const buffer_t *like) {
+	size_t alignment = like->alignment;
+
+	memset(cache, 0, sizeof(cache_t));
+	cache->mode = mode;
+	cache->llc_size = cache_llc_size();
+	cache->length = length;
+	cache->send = send;
+	cache->recv = recv;
+	if (pool_size == 0)
+		pool_size = 2*cache->llc_size;
+
+	switch (mode) {
+		case CACHE_WARM:
+			touch(send, length);
+			touch(recv, length);
+			break;
+		case CACHE_COLD:
+#if !defined(__x86_64__) && !defined(__i386__)
+			if (buffer_alloc(&cache->pool, pool_size,
+			    alignment, 0, like->kind))
+				return -1;
+#endif
+			break;
+		case CACHE_ROTATE:
+			/* one slot per buffer, each starting at 'offset' */
+			cache->slot_size = (length+like->offset+alignment) &
+			    ~(alignment-1);
+			cache->num_slots = pool_size/cache->slot_size;
+			cache->num_slots += cache->num_slots % 2;
+			if (cache->num_slots < 2)
+				cache->num_slots = 2;
+			if (buffer_alloc(&cache->pool,
+			    cache->num_slots*cache->slot_size, alignment,
+			    like->offset, like->kind))
+				return -1;
+			cache->slot = cache->num_slots-2;
+			cache_prepare(cache);
+			break;
+		default:
+			return -1;
+	}
+
+	return 0;
+}
+
+/* evict the message buffers from all cache levels */
+static void
+evict(cache_t *cache) {
+#if defined(__x86_64__) || defined(__i386__)
+	size_t i;
+
+	for (i=0; i<cache->length; i+=CACHE_LINE_SIZE) {
+		__builtin_ia32_clflush(cache->send+i);
+		__builtin_ia32_clflush(cache->recv+i);
+	}
+	if (cache->length) {
+		__builtin_ia32_clflush(cache->send+cache->length-1);
+		__builtin_ia32_clflush(cache->recv+cache->length-1);
+	}
+	__builtin_ia32_mfence();
+#else
+	/* no clflush; sweep over a buffer larger than the cache */
+	memset(cache->pool.ptr, (int)cache_dummy++, cache->pool.length);
+#endif
+}
+
+/* establish the cache state before a round; not to be timed */
+void
+cache_prepare(cache_t *cache) {
+	switch (cache->mode) {
+		case CACHE_COLD:
+			evict(cache);
+			break;
+		case CACHE_ROTATE:
+			cache->slot = (cache->slot+2) % cache->num_slots;
+			cache->send = cache->pool.ptr +
+			    cache->slot*cache->slot_size;
+			cache->recv = cache->send+cache->slot_size;
+			break;
+		default:
+			break;
+	}
+}
+
+void
+cache_free(cache_t *cache) {
+	buffer_free(&cache->pool);
+	memset(cache, 0, sizeof(cache_t));
+}
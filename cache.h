@@ -0,0 +1,61 @@
+#ifndef _CACHE_H
+#define _CACHE_H
+
+#include <stddef.h>
+
+#include <buffer.h>
+
+/*
+ * Cache state of the message buffers at the beginning of each round:
+ * 'warm' leaves the buffers of the previous round in the cache, 'cold'
+ * evicts them before every round and 'rotate' cycles the send/receive
+ * buffers through a pool that exceeds the last-level cache.
+ */
+#define CACHE_DEFAULT_LLC	(32*1024*1024)
+#define CACHE_LINE_SIZE		(64)
+
+typedef enum _cache_mode_t {
+	CACHE_WARM = 0,
+	CACHE_COLD,
+	CACHE_ROTATE,
+	CACHE_NUM_MODES
+} cache_mode_t;
+
+typedef struct _cache_t {
+	cache_mode_t mode;
+	size_t llc_size;	/* size of the last-level cache */
+	size_t length;		/* message length */
+	unsigned char *send;	/* message buffers of the next round */
+	unsigned char *recv;
+	buffer_t pool;		/* rotate: message slots, cold: eviction */
+	size_t slot_size;
+	size_t num_slots;
+	size_t slot;
+} cache_t;
+
+int
+cache_parse(const char *name,
+	    cache_mode_t *mode);
+
+const char *
+cache_name(cache_mode_t mode);
+
+size_t
+cache_llc_size(void);
+
+int
+cache_setup(cache_t *cache,
+	    cache_mode_t mode,
+	    unsigned char *send,
+	    unsigned char *recv,
+	    size_t length,
+	    size_t pool_size,
+	    const buffer_t *like);
+
+void
+cache_prepare(cache_t *cache);
+
+void
+cache_free(cache_t *cache);
+
+#endif /* _CACHE_H */
@@ -0,0 +1,921 @@
+/*
+ * Copyright 2017, Simon Pickartz Institute for Automation of Complex Power
+ * Systems,
+ *                                RWTH Aachen University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <errno.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <mpi.h>
+
+#include <adaptive.h>
+#include <bcast.h>
+#include <buffer.h>
+#include <cache.h>
+#include <report.h>
+#include <ringlog.h>
+#include <setup.h>
+#include <stat_eval.h>
+#include <timer.h>
+
+#undef _WATCH_DOG_
+
+#define DEFAULTLEN (0)
+#define DEFAULTCOLL "bcast"
+#define DEFAULTTYPE "char"
+#define DEFAULTOP "sum"
+#define DEFAULTROUNDS (10000)
+#define ADAPTIVEMAXROUNDS (1000000)
+#define DEFAULTITER (1)
+#define WARMUPITER (10000)
+#define STOPCHECKROUNDS (1000)
+#define SUMMARYVALS (6)
+#define MAXCOLLS (16)
+#define MAXSIZES (40)
+
+/* arguments passed to a collective kernel */
+typedef struct _coll_args_t {
+	void *send_buf;
+	void *recv_buf;
+	int count;
+	MPI_Datatype type;
+	MPI_Op op;
+	int root;
+	MPI_Comm comm;
+} coll_args_t;
+
+/* entry of the collective kernel table */
+typedef struct _coll_kernel_t {
+	const char *name;
+	const char *operation;	/* kernels of an operation are compared */
+	bool rooted;		/* root rotates with '-R' */
+	bool sized;		/* message size is swept */
+	bool reduction;		/* uses the reduction operation */
+	int (*run)(const coll_args_t *args);
+} coll_kernel_t;
+
+typedef struct _coll_type_t {
+	const char *name;
+	MPI_Datatype type;
+	size_t size;
+} coll_type_t;
+
+typedef struct _coll_op_t {
+	const char *name;
+	MPI_Op op;
+} coll_op_t;
+
+static int run_bcast(const coll_args_t *a) {
+	return MPI_Bcast(a->recv_buf, a->count, a->type, a->root, a->comm);
+}
+
+static int run_allreduce(const coll_args_t *a) {
+	return MPI_Allreduce(a->send_buf, a->recv_buf, a->count, a->type,
+			     a->op, a->comm);
+}
+
+static int run_reduce(const coll_args_t *a) {
+	return MPI_Reduce(a->send_buf, a->recv_buf, a->count, a->type, a->op,
+			  a->root, a->comm);
+}
+
+static int run_allgather(const coll_args_t *a) {
+	return MPI_Allgather(a->send_buf, a->count, a->type, a->recv_buf,
+			     a->count, a->type, a->comm);
+}
+
+static int run_alltoall(const coll_args_t *a) {
+	return MPI_Alltoall(a->send_buf, a->count, a->type, a->recv_buf,
+			    a->count, a->type, a->comm);
+}
+
+static int run_reduce_scatter(const coll_args_t *a) {
+	return MPI_Reduce_scatter_block(a->send_buf, a->recv_buf, a->count,
+					a->type, a->op, a->comm);
+}
+
+static int run_gather(const coll_args_t *a) {
+	return MPI_Gather(a->send_buf, a->count, a->type, a->recv_buf,
+			  a->count, a->type, a->root, a->comm);
+}
+
+static int run_scatter(const coll_args_t *a) {
+	return MPI_Scatter(a->send_buf, a->count, a->type, a->recv_buf,
+			   a->count, a->type, a->root, a->comm);
+}
+
+static int run_barrier(const coll_args_t *a) { return MPI_Barrier(a->comm); }
+
+/* pipeline segment size of the hand-rolled broadcasts */
+int segment_size = BCAST_DEFAULT_SEGMENT;
+
+static int run_bcast_binomial(const coll_args_t *a) {
+	return bcast_binomial(a->recv_buf, a->count, a->type, a->root,
+			      a->comm);
+}
+
+static int run_bcast_chain(const coll_args_t *a) {
+	return bcast_chain(a->recv_buf, a->count, a->type, a->root, a->comm,
+			   segment_size);
+}
+
+static int run_bcast_scatter_ring(const coll_args_t *a) {
+	return bcast_scatter_ring(a->recv_buf, a->count, a->type, a->root,
+				  a->comm);
+}
+
+static int run_bcast_split_binary(const coll_args_t *a) {
+	return bcast_split_binary(a->recv_buf, a->count, a->type, a->root,
+				  a->comm, segment_size);
+}
+
+/*
+ * the message size is the per-rank contribution (count elements); the
+ * kernel named after its operation is the library's implementation
+ */
+static const coll_kernel_t coll_kernels[] = {
+    {"bcast", "bcast", true, true, false, run_bcast},
+    {"allreduce", "allreduce", false, true, true, run_allreduce},
+    {"reduce", "reduce", true, true, true, run_reduce},
+    {"allgather", "allgather", false, true, false, run_allgather},
+    {"alltoall", "alltoall", false, true, false, run_alltoall},
+    {"reduce_scatter", "reduce_scatter", false, true, true,
+     run_reduce_scatter},
+    {"gather", "gather", true, true, false, run_gather},
+    {"scatter", "scatter", true, true, false, run_scatter},
+    {"barrier", "barrier", false, false, false, run_barrier},
+    {"bcast_binomial", "bcast", true, true, false, run_bcast_binomial},
+    {"bcast_chain", "bcast", true, true, false, run_bcast_chain},
+    {"bcast_scatter_ring", "bcast", true, true, false,
+     run_bcast_scatter_ring},
+    {"bcast_split_binary", "bcast", true, true, false,
+     run_bcast_split_binary},
+};
+#define NUMKERNELS (sizeof(coll_kernels) / sizeof(coll_kernels[0]))
+
+static const coll_type_t coll_types[] = {
+    {"char", MPI_SIGNED_CHAR, sizeof(signed char)},
+    {"int", MPI_INT, sizeof(int)},
+    {"long", MPI_LONG, sizeof(long)},
+    {"float", MPI_FLOAT, sizeof(float)},
+    {"double", MPI_DOUBLE, sizeof(double)},
+};
+#define NUMTYPES (sizeof(coll_types) / sizeof(coll_types[0]))
+
+static const coll_op_t coll_ops[] = {
+    {"sum", MPI_SUM},
+    {"prod", MPI_PROD},
+    {"min", MPI_MIN},
+    {"max", MPI_MAX},
+};
+#define NUMOPS (sizeof(coll_ops) / sizeof(coll_ops[0]))
+
+/* message buffers, sized for the largest per-rank contribution */
+buffer_t send_mem, recv_mem;
+unsigned char *send_buffer = NULL;
+unsigned char *recv_buffer = NULL;
+
+/* benchmark configuration */
+uint32_t iterations = DEFAULTITER;
+uint32_t warmup = WARMUPITER;
+int32_t numrounds = 0;
+bool run_infinitely = false;
+bool rotate_root = false;
+cache_mode_t cache_mode = CACHE_WARM;
+size_t pool_size = 0;
+ringlog_t *round_log = NULL;	/* per-round output, if requested */
+adaptive_t *adaptive = NULL;	/* stop criterion of adaptive runs */
+
+/* set by the signal handler to terminate infinite runs */
+volatile sig_atomic_t stop_requested = 0;
+
+static void stop_handler(int signum) {
+	(void)signum;
+	stop_requested = 1;
+}
+
+/* print the per-rank statistics gathered on the root */
+static void print_rank_breakdown(const double *summaries, int32_t num_ranks,
+				 FILE *output) {
+	int32_t rank;
+
+	fprintf(output, "##----------------------------------------------\n");
+	fprintf(output, "#Rank     Minimum  L-Quartil     Median  U-Quartil"
+			"    Maximum    Average\n");
+	for (rank = 0; rank < num_ranks; ++rank) {
+		const double *vals = &summaries[rank * SUMMARYVALS];
+
+		fprintf(output,
+			"#%-4d %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f\n",
+			rank, vals[0], vals[1], vals[2], vals[3], vals[4],
+			vals[5]);
+	}
+}
+
+/* one line of the sweep table; adaptive runs add rounds and CI width */
+static void print_table_row(const char *name, uint32_t length,
+			    const stat_eval_t *stat_eval, uint64_t count,
+			    FILE *output) {
+	fprintf(output, "%-19s %10u %10.2f %10.2f %10.2f %10.2f %10.2f",
+		name, length, stat_eval->minimum,
+		stat_eval->box_plot.median, stat_eval->box_plot.upper_quartil,
+		stat_eval->tail.num_percentiles
+		    ? stat_eval->tail
+			  .percentile_vals[stat_eval->tail.num_percentiles - 1]
+		    : stat_eval->maximum,
+		stat_eval->maximum);
+	if (adaptive)
+		fprintf(output, " %10" PRIu64 " %9.2f%%", count,
+			adaptive->width);
+	fprintf(output, "\n");
+}
+
+/*
+ * The fastest kernel (by median) per message size of each operation that
+ * was measured with several implementations, and its speedup over the
+ * library's implementation (if measured as well)
+ */
+static void print_winners(const coll_kernel_t **kernels, uint32_t num_kernels,
+			  double medians[][MAXSIZES], const uint32_t *lengths,
+			  const uint32_t *num_sizes, int32_t num_ranks,
+			  FILE *output) {
+	uint32_t i, j, k, best, num_impls;
+	int32_t library;
+	const char *operation;
+
+	for (i = 0; i < num_kernels; ++i) {
+		operation = kernels[i]->operation;
+		for (j = 0; j < i; ++j) {
+			if (strcmp(kernels[j]->operation, operation) == 0)
+				break;
+		}
+		if (j < i) continue;
+
+		num_impls = 0;
+		library = -1;
+		for (j = i; j < num_kernels; ++j) {
+			if (strcmp(kernels[j]->operation, operation)) continue;
+			num_impls++;
+			if (strcmp(kernels[j]->name, operation) == 0)
+				library = j;
+		}
+		if (num_impls < 2) continue;
+
+		fprintf(output,
+			"##----------------------------------------------\n");
+		fprintf(output, "#Fastest %s on %d ranks\n", operation,
+			num_ranks);
+		fprintf(output, "#%-9s %-19s %10s %10s %10s\n", "bytes",
+			"winner", "median", "library", "speedup");
+		for (k = 0; k < num_sizes[i]; ++k) {
+			best = i;
+			for (j = i + 1; j < num_kernels; ++j) {
+				if (strcmp(kernels[j]->operation, operation) ||
+				    (k >= num_sizes[j]))
+					continue;
+				if (medians[j][k] < medians[best][k]) best = j;
+			}
+			fprintf(output, "%-10u %-19s %10.2f", lengths[k],
+				kernels[best]->name, medians[best][k]);
+			if ((library >= 0) && (k < num_sizes[library]))
+				fprintf(output, " %10.2f %10.2f\n",
+					medians[library][k],
+					medians[library][k] / medians[best][k]);
+			else
+				fprintf(output, " %10s %10s\n", "-", "-");
+		}
+	}
+}
+
+/*
+ * Run one collective with one message size; 'stat_eval' (root only) holds
+ * the statistics of the per-round maximum over all ranks, 'rank_eval' the
+ * statistics of the calling rank. The per-round maxima are appended to
+ * 'raw' (root only, if given). Adaptive runs stop once the median of every
+ * rank has converged; 'info' receives the number of rounds.
+ */
+static uint64_t run_collective(const coll_kernel_t *kernel, coll_args_t *args,
+			       uint32_t length, int32_t my_rank,
+			       int32_t num_ranks, stat_eval_t *stat_eval,
+			       stat_eval_t *rank_eval, report_info_t *info,
+			       FILE *raw) {
+	uint32_t i;
+	int64_t round, rounds;
+	int32_t stop;
+	uint64_t count;
+	double timer, round_time, max_round_time;
+	double *time_stamps = NULL;
+	double *max_time_stamps = NULL;
+	stream_eval_t *stream_eval = NULL;
+	stream_eval_t *max_stream_eval = NULL;
+	unsigned char *send_buf = args->send_buf;
+	unsigned char *recv_buf = args->recv_buf;
+	cache_t cache;
+
+	/* the buffers hold the contributions of all ranks */
+	if (cache_setup(&cache, cache_mode, send_buf, recv_buf,
+			(size_t)length * num_ranks, pool_size, &send_mem)) {
+		setup_fail("cannot set up cache mode '%s'",
+			   cache_name(cache_mode));
+	}
+
+	if (run_infinitely) {
+		stream_eval = (stream_eval_t *)malloc(sizeof(stream_eval_t));
+		stream_eval_init(stream_eval);
+		if (my_rank == 0) {
+			max_stream_eval =
+			    (stream_eval_t *)malloc(sizeof(stream_eval_t));
+			stream_eval_init(max_stream_eval);
+		}
+	} else {
+		time_stamps = (double *)calloc(sizeof(double), numrounds);
+		if (my_rank == 0)
+			max_time_stamps =
+			    (double *)calloc(sizeof(double), numrounds);
+	}
+
+	/* synchronize and warm up */
+	MPI_Barrier(MPI_COMM_WORLD);
+	for (i = 0; i < warmup; ++i) {
+		args->root =
+		    (rotate_root && kernel->rooted) ? (int)(i % num_ranks) : 0;
+		kernel->run(args);
+	}
+
+	if (adaptive) adaptive_start(adaptive);
+	for (round = 0; run_infinitely || (round < numrounds); ++round) {
+		args->root = (rotate_root && kernel->rooted)
+				 ? (int)(round % num_ranks)
+				 : 0;
+		cache_prepare(&cache);
+		args->send_buf = cache.send;
+		args->recv_buf = cache.recv;
+		if (round_log) ringlog_flush(round_log, false);
+
+		/* common starting point for the completion time */
+		MPI_Barrier(MPI_COMM_WORLD);
+
+		/* start timer: */
+		timer = timer_now();
+
+		for (i = 0; i < iterations; ++i) {
+			kernel->run(args);
+		}
+
+		/* stop timer: */
+		timer = timer_elapsed(timer);
+		if (run_infinitely == false) {
+			time_stamps[round] = timer * 1e6 / iterations;
+		} else {
+			/* the round completes with the slowest rank */
+			round_time = timer * 1e6 / iterations;
+			stream_eval_add(stream_eval, round_time);
+			MPI_Reduce(&round_time, &max_round_time, 1, MPI_DOUBLE,
+				   MPI_MAX, 0, MPI_COMM_WORLD);
+			if (my_rank == 0)
+				stream_eval_add(max_stream_eval,
+						max_round_time);
+		}
+		if (round_log)
+			ringlog_put(round_log, length, timer / iterations * 1e6,
+				    0, 0);
+#ifdef _WATCH_DOG_
+		if (!(round % 100)) printf("Round %" PRId64 " ...\n", round);
+#endif
+
+		/* agree on termination of infinite runs */
+		if (run_infinitely && !((round + 1) % STOPCHECKROUNDS)) {
+			stop = stop_requested;
+			MPI_Allreduce(MPI_IN_PLACE, &stop, 1, MPI_INT32_T,
+				      MPI_LOR, MPI_COMM_WORLD);
+			if (stop) break;
+		}
+		if (adaptive && adaptive_check(adaptive, MPI_COMM_WORLD,
+					       round + 1, time_stamps,
+					       round + 1)) {
+			round++;
+			break;
+		}
+	}
+	rounds = round;
+
+	args->send_buf = send_buf;
+	args->recv_buf = recv_buf;
+	cache_free(&cache);
+	if (round_log) ringlog_flush(round_log, true);
+
+	/*
+	 * Statistical evaluation: the latency of a round is the completion
+	 * time of the slowest rank
+	 */
+	if (run_infinitely == true) {
+		stream_eval_finalize(stream_eval, rank_eval);
+		if (my_rank == 0)
+			stream_eval_finalize(max_stream_eval, stat_eval);
+		count = stream_eval->count;
+	} else {
+		MPI_Reduce(time_stamps, max_time_stamps, rounds, MPI_DOUBLE,
+			   MPI_MAX, 0, MPI_COMM_WORLD);
+		statistical_eval(time_stamps, rounds, rank_eval);
+		info->rounds = rounds;
+		if ((my_rank == 0) && raw &&
+		    report_dump_samples(raw, info, max_time_stamps, rounds, 1))
+			fprintf(stderr,
+				"WARNING: cannot write the raw samples\n");
+		if (my_rank == 0)
+			statistical_eval(max_time_stamps, rounds, stat_eval);
+		count = rounds;
+	}
+
+	free(time_stamps);
+	free(max_time_stamps);
+	free(stream_eval);
+	free(max_stream_eval);
+
+	return count;
+}
+
+int main(int argc, char **argv) {
+	int arg;
+	uint32_t i, j;
+	int32_t num_ranks;
+	int32_t my_rank;
+
+	uint32_t length = DEFAULTLEN;
+	uint32_t maxlen = 0;
+	uint64_t count;
+	char *colls = DEFAULTCOLL;
+	char *coll_name;
+	const coll_kernel_t *kernels[MAXCOLLS];
+	uint32_t num_kernels = 0;
+	size_t len;
+	double medians[MAXCOLLS][MAXSIZES];
+	uint32_t lengths[MAXSIZES];
+	uint32_t num_sizes[MAXCOLLS];
+	const coll_type_t *type = NULL;
+	const coll_op_t *op = NULL;
+	const char *type_name = DEFAULTTYPE;
+	const char *op_name = DEFAULTOP;
+	coll_args_t args;
+	setup_t setup;
+
+	double rank_summary[SUMMARYVALS];
+	double *rank_summaries = NULL;
+	stat_eval_t stat_eval, rank_eval;
+	bool single_run;
+	report_format_t format = REPORT_TEXT;
+	report_info_t info;
+	report_t report;
+	char *rawname = NULL;
+	FILE *raw = NULL;
+	ringlog_mode_t log_mode = RINGLOG_BATCH;
+	bool log_rounds = false, log_cost = false;
+	ringlog_t log;
+	double adaptive_target = 0, adaptive_budget = 0;
+	uint32_t adaptive_batch = 0;
+	adaptive_t adapt;
+
+	/* initialize MPI environment */
+	MPI_Init(&argc, &argv);
+	MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+	setup_init(&setup, my_rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+
+	/* determine arguments */
+	while ((arg = getopt(argc, argv,
+			     "i:r:l:L:c:d:o:W:hf:p:w:RC:K:F:D:I:Ta:b:n:S:"
+			     SETUP_OPTIONS)) != -1) {
+		switch (arg) {
+			case 'r':
+				numrounds = atoi(optarg);
+				break;
+			case 'l':
+				length = atoi(optarg);
+				break;
+			case 'L':
+				maxlen = atoi(optarg);
+				break;
+			case 'c':
+				colls = optarg;
+				break;
+			case 'd':
+				type_name = optarg;
+				break;
+			case 'o':
+				op_name = optarg;
+				break;
+			case 'W':
+				warmup = atoi(optarg);
+				break;
+			case 'i':
+				iterations = atoi(optarg);
+				break;
+			case 'p':
+				if (stat_eval_set_percentiles(optarg)) {
+					setup_abort(my_rank, "invalid "
+						    "percentile list '%s'",
+						    optarg);
+				}
+				break;
+			case 'w':
+				stat_eval_set_warmup(atoi(optarg));
+				break;
+			case 'R':
+				rotate_root = true;
+				break;
+			case 'C':
+				if (cache_parse(optarg, &cache_mode)) {
+					setup_abort(my_rank,
+						    "unknown cache mode '%s'",
+						    optarg);
+				}
+				break;
+			case 'K':
+				pool_size = strtoull(optarg, NULL, 0);
+				break;
+			case 'F':
+				if (report_parse(optarg, &format)) {
+					setup_abort(my_rank,
+						    "unknown format '%s'",
+						    optarg);
+				}
+				break;
+			case 'D':
+				rawname = optarg;
+				break;
+			case 'I':
+				if (ringlog_parse(optarg, &log_mode)) {
+					setup_abort(my_rank,
+						    "unknown logging mode '%s'",
+						    optarg);
+				}
+				log_rounds = true;
+				break;
+			case 'T':
+				log_cost = true;
+				break;
+			case 'a':
+				adaptive_target = atof(optarg);
+				break;
+			case 'b':
+				adaptive_budget = atof(optarg);
+				break;
+			case 'n':
+				adaptive_batch = atoi(optarg);
+				break;
+			case 'S':
+				segment_size = atoi(optarg);
+				break;
+			case 'h':
+				if (my_rank == 0) {
+					printf(
+					    "usage %s [-c collectives|all "
+					    "(def: %s)] "
+					    "[-l message_length (def: %d)] "
+					    "[-L max. message_length for a "
+					    "sweep] "
+					    "[-d datatype (def: %s)] "
+					    "[-o reduction op (def: %s)] "
+					    "[-i iterations (def: %d)] "
+					    "[-r rounds (def: %d)] "
+					    "[-W warm-up iterations (def: %d)] "
+					    "[-p percentiles (def: "
+					    "99,99.9,99.99)] "
+					    "[-w rounds excluded from steady "
+					    "max] "
+					    "[-R (rotate root across rounds)] "
+					    "[-C warm|cold|rotate (def: warm)] "
+					    "[-K rotating pool bytes "
+					    "(def: 2x LLC)] "
+					    "[-F text|csv|json (def: text)] "
+					    "[-D raw sample file] "
+					    "[-I direct|batch|thread "
+					    "(print rounds)] "
+					    "[-T (report the cost of -I)] "
+					    "[-a target CI width in %% of the "
+					    "median] "
+					    "[-b time budget per measurement "
+					    "in s] "
+					    "[-n rounds between CI checks "
+					    "(def: %d)] "
+					    "[-S pipeline segment bytes "
+					    "(def: %d)] ",
+					    argv[0], DEFAULTCOLL, DEFAULTLEN,
+					    DEFAULTTYPE, DEFAULTOP, DEFAULTITER,
+					    DEFAULTROUNDS, WARMUPITER,
+					    ADAPTIVE_DEFAULT_BATCH,
+					    BCAST_DEFAULT_SEGMENT);
+					setup_usage(stdout, true);
+					printf("\nrounds = -1 runs until "
+					       "SIGINT/SIGTERM/SIGUSR1\n"
+					       "with -a, rounds is the maximum "
+					       "(def: %d)\n"
+					       "<operation>_all selects all "
+					       "implementations (e.g., "
+					       "bcast_all)\n",
+					       ADAPTIVEMAXROUNDS);
+					printf("collectives:");
+					for (i = 0; i < NUMKERNELS; ++i)
+						printf(" %s",
+						       coll_kernels[i].name);
+					printf("\ndatatypes  :");
+					for (i = 0; i < NUMTYPES; ++i)
+						printf(" %s",
+						       coll_types[i].name);
+					printf("\nops        :");
+					for (i = 0; i < NUMOPS; ++i)
+						printf(" %s", coll_ops[i].name);
+					printf("\n");
+					fflush(stdout);
+				}
+				exit(0);
+			default:
+				setup_parse(&setup, arg, optarg);
+				break;
+		}
+	}
+
+	/* resolve the collectives, the datatype and the operation */
+	colls = strdup(colls);
+	if (strcmp(colls, "all") == 0) {
+		for (i = 0; i < NUMKERNELS; ++i) kernels[i] = &coll_kernels[i];
+		num_kernels = NUMKERNELS;
+	} else {
+		for (coll_name = strtok(colls, ","); coll_name;
+		     coll_name = strtok(NULL, ",")) {
+			/* '<operation>_all' selects every implementation */
+			len = strlen(coll_name);
+			if ((len > 4) && !strcmp(coll_name + len - 4, "_all")) {
+				coll_name[len - 4] = '\0';
+				for (j = 0; j < NUMKERNELS; ++j) {
+					if (strcmp(coll_name,
+						   coll_kernels[j].operation) ||
+					    (num_kernels == MAXCOLLS))
+						continue;
+					kernels[num_kernels++] =
+					    &coll_kernels[j];
+				}
+				continue;
+			}
+			for (j = 0; j < NUMKERNELS; ++j) {
+				if (!strcmp(coll_name, coll_kernels[j].name))
+					break;
+			}
+			if ((j == NUMKERNELS) || (num_kernels == MAXCOLLS)) {
+				setup_abort(my_rank, "unknown collective '%s'",
+					    coll_name);
+			}
+			kernels[num_kernels++] = &coll_kernels[j];
+		}
+	}
+	for (i = 0; i < NUMTYPES; ++i) {
+		if (strcmp(type_name, coll_types[i].name) == 0)
+			type = &coll_types[i];
+	}
+	for (i = 0; i < NUMOPS; ++i) {
+		if (strcmp(op_name, coll_ops[i].name) == 0) op = &coll_ops[i];
+	}
+	if ((type == NULL) || (op == NULL)) {
+		setup_abort(my_rank, "unknown datatype '%s' or operation '%s'",
+			    type_name, op_name);
+	}
+
+	/* sizes are whole elements: 'length' rounds up, 'maxlen' down */
+	if (length % type->size)
+		length += type->size - length % type->size;
+	maxlen -= maxlen % type->size;
+	if (maxlen < length) maxlen = length;
+
+	/* sweeps and multiple collectives are reported in a table */
+	single_run = (num_kernels == 1) && (maxlen == length);
+
+	/* adaptive runs stop at the latest after the given rounds */
+	if (numrounds == 0)
+		numrounds = (adaptive_target > 0) ? ADAPTIVEMAXROUNDS
+						  : DEFAULTROUNDS;
+
+	/* check for infinite test */
+	if (numrounds == -1) {
+		if (!single_run) {
+			setup_abort(my_rank, "infinite runs need a single "
+				    "collective and message length");
+		}
+		if (rawname) {
+			setup_abort(my_rank,
+				    "infinite runs keep no raw samples");
+		}
+		if (adaptive_target > 0) {
+			setup_abort(my_rank,
+				    "infinite runs cannot be adaptive");
+		}
+		run_infinitely = true;
+		signal(SIGINT, stop_handler);
+		signal(SIGTERM, stop_handler);
+		signal(SIGUSR1, stop_handler);
+	}
+	if (adaptive_target > 0) {
+		adaptive_init(&adapt, adaptive_target, adaptive_budget,
+			      adaptive_batch);
+		adaptive = &adapt;
+	}
+
+	/* select and calibrate the time source */
+	setup_timer(&setup);
+
+	/* per-rank contributions are gathered/exchanged with all ranks */
+	setup_buffer(&setup, &send_mem, (size_t)maxlen * num_ranks);
+	setup_buffer(&setup, &recv_mem, (size_t)maxlen * num_ranks);
+	send_buffer = send_mem.ptr;
+	recv_buffer = recv_mem.ptr;
+	if (my_rank == 0)
+		rank_summaries = (double *)calloc(sizeof(double),
+						  num_ranks * SUMMARYVALS);
+
+	/* per-round output of every rank */
+	if (log_rounds) {
+		if (ringlog_init(&log, log_mode, RINGLOG_DEFAULT_CAPACITY,
+				 stdout, "%.0f\t\t%1.2lf\n", log_cost)) {
+			setup_fail("cannot set up the round output");
+		}
+		round_log = &log;
+	}
+
+	/* metadata of the machine-readable output */
+	report_info_collect(MPI_COMM_WORLD, &info);
+	info.benchmark = "coll_lat";
+	info.rounds = numrounds;
+	info.iterations = iterations;
+
+	/* the banner would corrupt machine-readable output on stdout */
+	if ((my_rank == 0) && ((format == REPORT_TEXT) || setup.filename)) {
+		printf("Starting the benchmark:\n");
+		if (numrounds == -1) {
+			printf("Rounds     :        inf\n");
+		} else {
+			printf("Rounds     : %10d%s\n", numrounds,
+			       adaptive ? " (max.)" : "");
+		}
+		if (adaptive) {
+			printf("Adaptive   : %9.2f%% (%d%% CI of the median, "
+			       "batch %u", adapt.target, ADAPTIVE_CONFIDENCE,
+			       adapt.batch);
+			if (adapt.budget > 0)
+				printf(", budget %g s", adapt.budget);
+			printf(")\n");
+		}
+		printf("Iterations : %10d\n", iterations);
+		if (maxlen == length) {
+			printf("Msg Length : %10d\n", length);
+		} else {
+			printf("Msg Length : %10d - %d\n", length, maxlen);
+		}
+		printf("Datatype   : %10s\n", type->name);
+		printf("Operation  : %10s\n", op->name);
+		printf("Ranks      : %10d\n", num_ranks);
+		setup_print(&setup, false);
+		printf("Cache      : %10s\n", cache_name(cache_mode));
+		for (i = 0; i < num_kernels; ++i) {
+			if (strcmp(kernels[i]->name, kernels[i]->operation) &&
+			    !strcmp(kernels[i]->operation, "bcast"))
+				break;
+		}
+		if (i < num_kernels)
+			printf("Segment    : %10d\n", segment_size);
+		if (rotate_root) {
+			printf("Root       :   rotating\n");
+		} else {
+			printf("Root       : %10d\n", 0);
+		}
+	}
+
+	/* print the results */
+	FILE *output = stdout;
+	output = setup_output(&setup);
+	if ((my_rank == 0) && rawname && !(raw = fopen(rawname, "wb"))) {
+		setup_fail("cannot open '%s'", rawname);
+	}
+	if (my_rank == 0) {
+		report_begin(&report, format, output);
+	}
+	if ((my_rank == 0) && !single_run && (format == REPORT_TEXT)) {
+		fprintf(output, "#%-18s %10s %10s %10s %10s %10s %10s",
+			"collective", "bytes", "min", "median", "u-quartil",
+			"tail", "max");
+		if (adaptive)
+			fprintf(output, " %10s %10s", "rounds", "ci-width");
+		fprintf(output, "\n");
+	}
+
+	args.send_buf = send_buffer;
+	args.recv_buf = recv_buffer;
+	args.type = type->type;
+	args.op = op->op;
+	args.comm = MPI_COMM_WORLD;
+
+	for (i = 0; i < num_kernels; ++i) {
+		uint32_t cur_len = length;
+
+		num_sizes[i] = 0;
+		for (;;) {
+			args.count = cur_len / type->size;
+			info.variant = kernels[i]->name;
+			info.length = (uint64_t)args.count * type->size;
+			count = run_collective(kernels[i], &args, cur_len,
+					       my_rank, num_ranks, &stat_eval,
+					       &rank_eval, &info, raw);
+
+			if (format != REPORT_TEXT) {
+				if (my_rank == 0)
+					report_record(&report, &info,
+						      &stat_eval, count);
+			} else if (single_run) {
+				/* the per-rank statistics for the breakdown */
+				rank_summary[0] = rank_eval.minimum;
+				rank_summary[1] =
+				    rank_eval.box_plot.lower_quartil;
+				rank_summary[2] = rank_eval.box_plot.median;
+				rank_summary[3] =
+				    rank_eval.box_plot.upper_quartil;
+				rank_summary[4] = rank_eval.maximum;
+				rank_summary[5] = rank_eval.average;
+				MPI_Gather(rank_summary, SUMMARYVALS,
+					   MPI_DOUBLE, rank_summaries,
+					   SUMMARYVALS, MPI_DOUBLE, 0,
+					   MPI_COMM_WORLD);
+
+				if (my_rank == 0) {
+					print_statistics(&stat_eval, count,
+							 output);
+					if (adaptive)
+						adaptive_print(adaptive, count,
+							       output);
+					print_rank_breakdown(rank_summaries,
+							     num_ranks, output);
+				}
+			} else if (my_rank == 0) {
+				print_table_row(kernels[i]->name, cur_len,
+						&stat_eval, count, output);
+				fflush(output);
+			}
+			if ((my_rank == 0) && (num_sizes[i] < MAXSIZES)) {
+				lengths[num_sizes[i]] = cur_len;
+				medians[i][num_sizes[i]++] =
+				    stat_eval.box_plot.median;
+			}
+
+			/* barrier is not sized; power-of-two sweep from one
+			 * element on */
+			if (!kernels[i]->sized || (cur_len >= maxlen)) break;
+			cur_len = cur_len ? cur_len * 2 : type->size;
+			if (cur_len > maxlen) cur_len = maxlen;
+		}
+	}
+
+	if ((my_rank == 0) && !single_run && (format == REPORT_TEXT)) {
+		print_winners(kernels, num_kernels, medians, lengths, num_sizes,
+			      num_ranks, output);
+	}
+
+	if (round_log) {
+		ringlog_finish(round_log);
+		if (log_cost) ringlog_report(round_log, stdout);
+	}
+	if (my_rank == 0) {
+		report_end(&report);
+	}
+	setup_close(&setup);
+	if (raw) {
+		fclose(raw);
+	}
+
+	free(colls);
+	buffer_free(&send_mem);
+	buffer_free(&recv_mem);
+	free(rank_summaries);
+	report_info_free(&info);
+
+	MPI_Finalize();
+
+	return 0;
+}
@@ -0,0 +1,444 @@
+/*
+ * Copyright 2017, Simon Pickartz Institute for Automation of Complex Power
+ * Systems,
+ *                                RWTH Aachen University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Overlap of non-blocking collectives with computation. For each message
+ * size, every rank measures (medians over all rounds)
+ *   - blocking:  the blocking collective
+ *   - post+wait: the non-blocking collective without computation
+ *   - compute:   the compute kernel alone, calibrated to 'factor' times the
+ *                slowest post+wait time
+ *   - overall:   post, compute (optionally polling with MPI_Test()), wait
+ * The overlap is 1 - (overall - compute) / (post+wait), i.e., the share of
+ * the communication that is hidden behind the computation. The gain compares
+ * the blocking version (blocking + compute) with the overlapped one.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <mpi.h>
+#include <omp.h>
+
+#include <buffer.h>
+#include <setup.h>
+#include <stat_eval.h>
+#include <timer.h>
+
+#define DEFAULTLEN (1)
+#define DEFAULTMAXLEN (1024 * 1024)
+#define DEFAULTCOLL "ibcast,iallreduce"
+#define DEFAULTROUNDS (200)
+#define WARMUPROUNDS (20)
+#define DEFAULTFACTOR (1.0)
+#define DEFAULTPOLL (0)
+#define CALIBROUNDS (100)
+#define WORKELEMS (4096)
+#define MAXCOLLS (8)
+
+/* arguments passed to a collective kernel */
+typedef struct _coll_args_t {
+	void *send_buf;
+	void *recv_buf;
+	int count;
+	MPI_Comm comm;
+} coll_args_t;
+
+/* a collective in its blocking and non-blocking form */
+typedef struct _coll_kernel_t {
+	const char *name;
+	int (*blocking)(const coll_args_t *args);
+	int (*start)(const coll_args_t *args, MPI_Request *req);
+} coll_kernel_t;
+
+static int run_bcast(const coll_args_t *a) {
+	return MPI_Bcast(a->recv_buf, a->count, MPI_SIGNED_CHAR, 0, a->comm);
+}
+
+static int start_ibcast(const coll_args_t *a, MPI_Request *req) {
+	return MPI_Ibcast(a->recv_buf, a->count, MPI_SIGNED_CHAR, 0, a->comm,
+			  req);
+}
+
+static int run_allreduce(const coll_args_t *a) {
+	return MPI_Allreduce(a->send_buf, a->recv_buf, a->count,
+			     MPI_SIGNED_CHAR, MPI_SUM, a->comm);
+}
+
+static int start_iallreduce(const coll_args_t *a, MPI_Request *req) {
+	return MPI_Iallreduce(a->send_buf, a->recv_buf, a->count,
+			      MPI_SIGNED_CHAR, MPI_SUM, a->comm, req);
+}
+
+static int run_allgather(const coll_args_t *a) {
+	return MPI_Allgather(a->send_buf, a->count, MPI_SIGNED_CHAR,
+			     a->recv_buf, a->count, MPI_SIGNED_CHAR, a->comm);
+}
+
+static int start_iallgather(const coll_args_t *a, MPI_Request *req) {
+	return MPI_Iallgather(a->send_buf, a->count, MPI_SIGNED_CHAR,
+			      a->recv_buf, a->count, MPI_SIGNED_CHAR, a->comm,
+			      req);
+}
+
+static int run_alltoall(const coll_args_t *a) {
+	return MPI_Alltoall(a->send_buf, a->count, MPI_SIGNED_CHAR,
+			    a->recv_buf, a->count, MPI_SIGNED_CHAR, a->comm);
+}
+
+static int start_ialltoall(const coll_args_t *a, MPI_Request *req) {
+	return MPI_Ialltoall(a->send_buf, a->count, MPI_SIGNED_CHAR,
+			     a->recv_buf, a->count, MPI_SIGNED_CHAR, a->comm,
+			     req);
+}
+
+/* the message size is the per-rank contribution */
+static const coll_kernel_t coll_kernels[] = {
+    {"ibcast", run_bcast, start_ibcast},
+    {"iallreduce", run_allreduce, start_iallreduce},
+    {"iallgather", run_allgather, start_iallgather},
+    {"ialltoall", run_alltoall, start_ialltoall},
+};
+#define NUMKERNELS (sizeof(coll_kernels) / sizeof(coll_kernels[0]))
+
+/* message buffers, sized for the largest per-rank contribution */
+buffer_t send_mem, recv_mem;
+
+/* benchmark configuration */
+int32_t numrounds = DEFAULTROUNDS;
+uint32_t poll_interval = DEFAULTPOLL;
+
+/* data of the compute kernel */
+double *work = NULL;
+
+/* phases measured per message size */
+#define PHASE_BLOCKING 0
+#define PHASE_POSTWAIT 1
+#define PHASE_COMPUTE 2
+#define PHASE_OVERALL 3
+#define NUMPHASES 4
+
+/*
+ * 'chunks' parallel sweeps over the work array; the master thread polls
+ * the request (if given) every 'poll_interval' chunks
+ */
+static void compute(uint32_t chunks, MPI_Request *req) {
+	uint32_t chunk;
+	int i, flag;
+
+	for (chunk = 0; chunk < chunks; ++chunk) {
+#pragma omp parallel for
+		for (i = 0; i < WORKELEMS; ++i)
+			work[i] = work[i] * 0.999999 + 1e-6;
+
+		if (req && poll_interval && !((chunk + 1) % poll_interval))
+			MPI_Test(req, &flag, MPI_STATUS_IGNORE);
+	}
+}
+
+/* median duration (usec) of one compute chunk on this rank */
+static double calibrate_chunk(double *samples) {
+	stat_eval_t stat_eval;
+	double timer;
+	int32_t round;
+
+	compute(CALIBROUNDS, NULL);
+	for (round = 0; round < CALIBROUNDS; ++round) {
+		timer = timer_now();
+		compute(1, NULL);
+		samples[round] = timer_elapsed(timer) * 1e6;
+	}
+	statistical_eval(samples, CALIBROUNDS, &stat_eval);
+
+	return stat_eval.box_plot.median;
+}
+
+/* median duration (usec) of one phase over all rounds */
+static double measure_phase(const coll_kernel_t *kernel,
+			    const coll_args_t *args, int phase,
+			    uint32_t chunks, double *samples) {
+	stat_eval_t stat_eval;
+	MPI_Request req;
+	double timer;
+	int32_t round;
+
+	for (round = -WARMUPROUNDS; round < numrounds; ++round) {
+		/* common starting point for the completion time */
+		MPI_Barrier(args->comm);
+
+		/* start timer: */
+		timer = timer_now();
+
+		switch (phase) {
+			case PHASE_BLOCKING:
+				kernel->blocking(args);
+				break;
+			case PHASE_POSTWAIT:
+				kernel->start(args, &req);
+				MPI_Wait(&req, MPI_STATUS_IGNORE);
+				break;
+			case PHASE_COMPUTE:
+				compute(chunks, NULL);
+				break;
+			default:
+				kernel->start(args, &req);
+				compute(chunks, &req);
+				MPI_Wait(&req, MPI_STATUS_IGNORE);
+				break;
+		}
+
+		/* stop timer: */
+		timer = timer_elapsed(timer);
+		if (round >= 0) samples[round] = timer * 1e6;
+	}
+	statistical_eval(samples, numrounds, &stat_eval);
+
+	return stat_eval.box_plot.median;
+}
+
+int main(int argc, char **argv) {
+	int arg, provided;
+	uint32_t i, j;
+	int32_t num_ranks;
+	int32_t my_rank;
+
+	uint32_t length = DEFAULTLEN;
+	uint32_t maxlen = DEFAULTMAXLEN;
+	uint32_t cur_len;
+	double factor = DEFAULTFACTOR;
+	char *colls = DEFAULTCOLL;
+	char *coll_name;
+	const coll_kernel_t *kernels[MAXCOLLS];
+	uint32_t num_kernels = 0;
+	coll_args_t args;
+	setup_t setup;
+	FILE *output = stdout;
+
+	double *samples;
+	double chunk_time, target;
+	uint32_t chunks;
+	double times[NUMPHASES], overlap, min_overlap, sum_overlap;
+	double max_times[NUMPHASES];
+
+	/* the compute kernel runs in OpenMP regions of the master thread */
+	MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+	MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+	setup_init(&setup, my_rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+
+	/* determine arguments */
+	while ((arg = getopt(argc, argv,
+			     "c:l:L:r:k:P:f:h" SETUP_OPTIONS)) != -1) {
+		switch (arg) {
+			case 'c':
+				colls = optarg;
+				break;
+			case 'l':
+				length = atoi(optarg);
+				break;
+			case 'L':
+				maxlen = atoi(optarg);
+				break;
+			case 'r':
+				numrounds = atoi(optarg);
+				break;
+			case 'k':
+				factor = atof(optarg);
+				break;
+			case 'P':
+				poll_interval = atoi(optarg);
+				break;
+			case 'h':
+				if (my_rank == 0) {
+					printf(
+					    "usage %s [-c collectives|all "
+					    "(def: %s)] "
+					    "[-l message_length (def: %d)] "
+					    "[-L max. message_length "
+					    "(def: %d)] "
+					    "[-r rounds (def: %d)] "
+					    "[-k compute time / communication "
+					    "time (def: %g)] "
+					    "[-P MPI_Test every n compute "
+					    "chunks (def: %d = no polling)] ",
+					    argv[0], DEFAULTCOLL, DEFAULTLEN,
+					    DEFAULTMAXLEN, DEFAULTROUNDS,
+					    DEFAULTFACTOR, DEFAULTPOLL);
+					setup_usage(stdout, true);
+					printf("\nthreads: OMP_NUM_THREADS\n");
+					printf("collectives:");
+					for (i = 0; i < NUMKERNELS; ++i)
+						printf(" %s",
+						       coll_kernels[i].name);
+					printf("\n");
+					fflush(stdout);
+				}
+				exit(0);
+			default:
+				setup_parse(&setup, arg, optarg);
+				break;
+		}
+	}
+
+	if (provided < MPI_THREAD_FUNNELED) {
+		if (my_rank == 0) {
+			fprintf(stderr, "WARNING: MPI_THREAD_FUNNELED is not "
+				"supported\n");
+		}
+	}
+	if (numrounds < 1) numrounds = 1;
+
+	/* resolve the collectives */
+	colls = strdup(colls);
+	if (strcmp(colls, "all") == 0) {
+		for (i = 0; i < NUMKERNELS; ++i) kernels[i] = &coll_kernels[i];
+		num_kernels = NUMKERNELS;
+	} else {
+		for (coll_name = strtok(colls, ","); coll_name;
+		     coll_name = strtok(NULL, ",")) {
+			for (j = 0; j < NUMKERNELS; ++j) {
+				if (!strcmp(coll_name, coll_kernels[j].name))
+					break;
+			}
+			if ((j == NUMKERNELS) || (num_kernels == MAXCOLLS)) {
+				setup_abort(my_rank, "unknown collective '%s'",
+					    coll_name);
+			}
+			kernels[num_kernels++] = &coll_kernels[j];
+		}
+	}
+	if (maxlen < length) maxlen = length;
+
+	/* select and calibrate the time source */
+	setup_timer(&setup);
+
+	/* per-rank contributions are gathered/exchanged with all ranks */
+	setup_buffer(&setup, &send_mem, (size_t)maxlen * num_ranks);
+	setup_buffer(&setup, &recv_mem, (size_t)maxlen * num_ranks);
+	work = (double *)malloc(sizeof(double) * WORKELEMS);
+	for (i = 0; i < WORKELEMS; ++i) work[i] = i;
+	samples = (double *)malloc(sizeof(double) *
+				   ((numrounds > CALIBROUNDS) ? numrounds
+							      : CALIBROUNDS));
+	chunk_time = calibrate_chunk(samples);
+
+	if (my_rank == 0) {
+		printf("Starting the benchmark:\n");
+		printf("Rounds     : %10d\n", numrounds);
+		printf("Msg Length : %10d - %d\n", length, maxlen);
+		printf("Ranks      : %10d\n", num_ranks);
+		printf("Threads    : %10d\n", omp_get_max_threads());
+		printf("Compute    : %10.2f x post+wait (chunk %.2f usec)\n",
+		       factor, chunk_time);
+		if (poll_interval) {
+			printf("Polling    : every %u chunks\n", poll_interval);
+		} else {
+			printf("Polling    :       none\n");
+		}
+		setup_print(&setup, false);
+	}
+
+	output = setup_output(&setup);
+	if (my_rank == 0) {
+		fprintf(output,
+			"#%-15s %10s %10s %10s %10s %10s %10s %11s %10s\n",
+			"collective", "bytes", "blocking", "post+wait",
+			"compute", "overall", "overlap", "min-overlap", "gain");
+	}
+
+	args.send_buf = send_mem.ptr;
+	args.recv_buf = recv_mem.ptr;
+	args.comm = MPI_COMM_WORLD;
+
+	for (i = 0; i < num_kernels; ++i) {
+		cur_len = length;
+		for (;;) {
+			args.count = cur_len;
+			times[PHASE_BLOCKING] = measure_phase(
+			    kernels[i], &args, PHASE_BLOCKING, 0, samples);
+			times[PHASE_POSTWAIT] = measure_phase(
+			    kernels[i], &args, PHASE_POSTWAIT, 0, samples);
+
+			/* all compute as long as the slowest communicates */
+			MPI_Allreduce(&times[PHASE_POSTWAIT], &target, 1,
+				      MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+			target *= factor;
+			chunks = (uint32_t)(target / chunk_time + 0.5);
+			if (chunks == 0) chunks = 1;
+
+			times[PHASE_COMPUTE] = measure_phase(
+			    kernels[i], &args, PHASE_COMPUTE, chunks, samples);
+			times[PHASE_OVERALL] = measure_phase(
+			    kernels[i], &args, PHASE_OVERALL, chunks, samples);
+
+			/* the share of the communication hidden by this rank */
+			overlap = 1 - (times[PHASE_OVERALL] -
+				       times[PHASE_COMPUTE]) /
+					  times[PHASE_POSTWAIT];
+			if (overlap < 0) overlap = 0;
+			if (overlap > 1) overlap = 1;
+
+			MPI_Reduce(times, max_times, NUMPHASES, MPI_DOUBLE,
+				   MPI_MAX, 0, MPI_COMM_WORLD);
+			MPI_Reduce(&overlap, &min_overlap, 1, MPI_DOUBLE,
+				   MPI_MIN, 0, MPI_COMM_WORLD);
+			MPI_Reduce(&overlap, &sum_overlap, 1, MPI_DOUBLE,
+				   MPI_SUM, 0, MPI_COMM_WORLD);
+
+			/* slowest rank per phase, mean overlap over ranks */
+			if (my_rank == 0) {
+				fprintf(output,
+					"%-16s %10u %10.2f %10.2f %10.2f "
+					"%10.2f %9.1f%% %10.1f%% %10.2f\n",
+					kernels[i]->name, cur_len,
+					max_times[PHASE_BLOCKING],
+					max_times[PHASE_POSTWAIT],
+					max_times[PHASE_COMPUTE],
+					max_times[PHASE_OVERALL],
+					sum_overlap / num_ranks * 100,
+					min_overlap * 100,
+					(max_times[PHASE_BLOCKING] +
+					 max_times[PHASE_COMPUTE]) /
+					    max_times[PHASE_OVERALL]);
+				fflush(output);
+			}
+
+			/* power-of-two sweep */
+			if (cur_len >= maxlen) break;
+			cur_len = cur_len ? cur_len * 2 : 1;
+			if (cur_len > maxlen) cur_len = maxlen;
+		}
+	}
+
+	setup_close(&setup);
+
+	free(colls);
+	free(samples);
+	free(work);
+	buffer_free(&send_mem);
+	buffer_free(&recv_mem);
+
+	MPI_Finalize();
+
+	return 0;
+}
@@ -0,0 +1,187 @@
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <congestion.h>
+
+static const char *congestion_names[CONGESTION_NUM_MODES] = {
+	"alltoall", "incast", "stream"
+};
+
+/* translate a mode name given on the command line */
+int
+congestion_parse(const char *name,
+		 congestion_mode_t *mode) {
+	int i;
+
+	for (i=0; i<CONGESTION_NUM_MODES; ++i) {
+		if (strcmp(name, congestion_names[i]) == 0) {
+			*mode = (congestion_mode_t)i;
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+const char *
+congestion_name(congestion_mode_t mode) {
+	return (mode < CONGESTION_NUM_MODES) ? congestion_names[mode]
+					     : "unknown";
+}
+
+/* collective over 'world'; all ranks but the measured pair become loaders */
+int
+congestion_setup(congestion_t *congestion,
+		 congestion_mode_t mode,
+		 MPI_Comm world,
+		 int32_t initiator,
+		 int32_t receiver,
+		 uint32_t length) {
+	int32_t i, my_rank, num_ranks;
+	bool loader;
+	size_t size;
+
+	if (mode >= CONGESTION_NUM_MODES)
+		return -1;
+	MPI_Comm_rank(world, &my_rank);
+	MPI_Comm_size(world, &num_ranks);
+
+	memset(congestion, 0, sizeof(congestion_t));
+	congestion->mode = mode;
+	congestion->world = world;
+	congestion->initiator = initiator;
+	congestion->receiver = receiver;
+	congestion->length = length;
+	congestion->comm = MPI_COMM_NULL;
+	congestion->win = MPI_WIN_NULL;
+	congestion->loaders = (int32_t *)malloc(sizeof(int32_t)*num_ranks);
+	for (i=0; i<num_ranks; ++i) {
+		if ((i != initiator) && (i != receiver))
+			congestion->loaders[congestion->num_loaders++] = i;
+	}
+
+	loader = (my_rank != initiator) && (my_rank != receiver);
+	MPI_Comm_split(world, loader ? 0 : MPI_UNDEFINED, my_rank,
+		       &congestion->comm);
+
+	/* all-to-all exchanges one message with every loader */
+	size = length;
+	if (mode == CONGESTION_ALLTOALL)
+		size *= congestion->num_loaders;
+	if (loader || ((mode == CONGESTION_INCAST) && (my_rank == receiver))) {
+		congestion->send_buf = (unsigned char *)calloc(1, size);
+		congestion->recv_buf = (unsigned char *)calloc(1, size);
+		if (!congestion->send_buf || !congestion->recv_buf)
+			return -1;
+	}
+
+	/* the loaders expose nothing */
+	if (mode == CONGESTION_INCAST) {
+		MPI_Win_create(congestion->recv_buf,
+			       (my_rank == receiver) ? length : 0, 1,
+			       MPI_INFO_NULL, world, &congestion->win);
+		MPI_Win_lock_all(MPI_MODE_NOCHECK, congestion->win);
+	}
+
+	return 0;
+}
+
+/* one load operation; returns the bytes injected by this loader */
+static double
+congestion_inject(congestion_t *congestion) {
+	int rank, size;
+
+	MPI_Comm_rank(congestion->comm, &rank);
+	MPI_Comm_size(congestion->comm, &size);
+
+	switch (congestion->mode) {
+		case CONGESTION_ALLTOALL:
+			MPI_Alltoall(congestion->send_buf, congestion->length,
+				     MPI_BYTE, congestion->recv_buf,
+				     congestion->length, MPI_BYTE,
+				     congestion->comm);
+			return (double)congestion->length*(size-1);
+		case CONGESTION_INCAST:
+			MPI_Put(congestion->send_buf, congestion->length,
+				MPI_BYTE, congestion->receiver, 0,
+				congestion->length, MPI_BYTE, congestion->win);
+			MPI_Win_flush(congestion->receiver, congestion->win);
+			return congestion->length;
+		default:
+			MPI_Sendrecv(congestion->send_buf, congestion->length,
+				     MPI_BYTE, (rank+1)%size, CONGESTION_TAG,
+				     congestion->recv_buf, congestion->length,
+				     MPI_BYTE, (rank-1+size)%size,
+				     CONGESTION_TAG, congestion->comm,
+				     MPI_STATUS_IGNORE);
+			return congestion->length;
+	}
+}
+
+/*
+ * Loaders only: inject load at 'rate' bytes/s until the initiator calls
+ * congestion_stop(); the loaders agree on the stop after each operation.
+ * Returns the achieved rate in bytes/s.
+ */
+double
+congestion_run(congestion_t *congestion,
+	       double rate) {
+	MPI_Request stop_req;
+	double start, bytes = 0;
+	int stop = 0;
+
+	MPI_Irecv(NULL, 0, MPI_BYTE, congestion->initiator, CONGESTION_TAG,
+		  congestion->world, &stop_req);
+	start = MPI_Wtime();
+
+	/* no load: wait for the end of the measurement */
+	if (rate <= 0) {
+		MPI_Wait(&stop_req, MPI_STATUS_IGNORE);
+		return 0;
+	}
+
+	while (!stop) {
+		bytes += congestion_inject(congestion);
+
+		/* pace the injection to the target rate */
+		while (MPI_Wtime()-start < bytes/rate) {
+			MPI_Test(&stop_req, &stop, MPI_STATUS_IGNORE);
+			if (stop)
+				break;
+		}
+		if (!stop)
+			MPI_Test(&stop_req, &stop, MPI_STATUS_IGNORE);
+		MPI_Allreduce(MPI_IN_PLACE, &stop, 1, MPI_INT, MPI_LOR,
+			      congestion->comm);
+	}
+	MPI_Wait(&stop_req, MPI_STATUS_IGNORE);
+
+	return bytes/(MPI_Wtime()-start);
+}
+
+/* the initiator ends the load after its measurement */
+void
+congestion_stop(const congestion_t *congestion) {
+	int32_t i;
+
+	for (i=0; i<congestion->num_loaders; ++i)
+		MPI_Send(NULL, 0, MPI_BYTE, congestion->loaders[i],
+			 CONGESTION_TAG, congestion->world);
+}
+
+/* collective over 'world' */
+void
+congestion_free(congestion_t *congestion) {
+	if (congestion->win != MPI_WIN_NULL) {
+		MPI_Win_unlock_all(congestion->win);
+		MPI_Win_free(&congestion->win);
+	}
+	if (congestion->comm != MPI_COMM_NULL)
+		MPI_Comm_free(&congestion->comm);
+	free(congestion->loaders);
+	free(congestion->send_buf);
+	free(congestion->recv_buf);
+	memset(congestion, 0, sizeof(congestion_t));
+}
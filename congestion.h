@@ -0,0 +1,67 @@
+#ifndef _CONGESTION_H
+#define _CONGESTION_H
+
+#include <stdint.h>
+
+#include <mpi.h>
+
+/*
+ * Background traffic of the ranks that are not measured ("loaders"):
+ *   - alltoall: MPI_Alltoall() among the loaders
+ *   - incast:   every loader puts its messages into a window on the
+ *               measured receiver (one-sided, so the receiver's ping-pong
+ *               loop needs not drain them)
+ *   - stream:   the loaders pass messages around a ring
+ * Each loader injects at most 'rate' bytes per second (INFINITY: as fast
+ * as possible, 0: no load) until the measured initiator stops the load.
+ */
+#define CONGESTION_DEFAULT_LENGTH	(65536)
+#define CONGESTION_TAG			(4343)
+
+typedef enum _congestion_mode_t {
+	CONGESTION_ALLTOALL = 0,
+	CONGESTION_INCAST,
+	CONGESTION_STREAM,
+	CONGESTION_NUM_MODES
+} congestion_mode_t;
+
+typedef struct _congestion_t {
+	congestion_mode_t mode;
+	MPI_Comm comm;		/* the loaders; MPI_COMM_NULL elsewhere */
+	int32_t num_loaders;
+	int32_t *loaders;	/* ranks of the loaders in 'world' */
+	int32_t initiator;	/* the measured pair */
+	int32_t receiver;
+	uint32_t length;	/* bytes per message (and peer) */
+	unsigned char *send_buf;
+	unsigned char *recv_buf;
+	MPI_Win win;		/* incast target on the receiver */
+	MPI_Comm world;
+} congestion_t;
+
+int
+congestion_parse(const char *name,
+		 congestion_mode_t *mode);
+
+const char *
+congestion_name(congestion_mode_t mode);
+
+int
+congestion_setup(congestion_t *congestion,
+		 congestion_mode_t mode,
+		 MPI_Comm world,
+		 int32_t initiator,
+		 int32_t receiver,
+		 uint32_t length);
+
+double
+congestion_run(congestion_t *congestion,
+	       double rate);
+
+void
+congestion_stop(const congestion_t *congestion);
+
+void
+congestion_free(congestion_t *congestion);
+
+#endif /* _CONGESTION_H */
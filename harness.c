@@ -0,0 +1,163 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <harness.h>
+#include <timer.h>
+
+/*
+ * whole elements of the kernel: 'length' rounds up, 'maxlen' down; the
+ * range stays valid
+ */
+void
+harness_align_range(const harness_kernel_t *kernel,
+		    uint32_t *length,
+		    uint32_t *maxlen) {
+	if (*length%kernel->unit)
+		*length += kernel->unit-*length%kernel->unit;
+	*maxlen -= *maxlen%kernel->unit;
+	if (*maxlen < *length)
+		*maxlen = *length;
+}
+
+size_t
+harness_buffer_size(const harness_kernel_t *kernel,
+		    uint32_t length,
+		    int32_t num_ranks) {
+	if (!kernel->sized)
+		return 0;
+
+	return kernel->buffer_size ? kernel->buffer_size(length, num_ranks)
+				   : length;
+}
+
+/* collective over 'comm'; rank 0 writes to the setup's output */
+void
+harness_init(harness_t *harness,
+	     MPI_Comm comm,
+	     const setup_t *setup,
+	     size_t buffer_size,
+	     int32_t rounds,
+	     int32_t warmup,
+	     report_format_t format) {
+	memset(harness, 0, sizeof(harness_t));
+	harness->comm = comm;
+	MPI_Comm_rank(comm, &harness->my_rank);
+	MPI_Comm_size(comm, &harness->num_ranks);
+	harness->rounds = (rounds > 0) ? rounds : 1;
+	harness->warmup = (warmup > 0) ? warmup : 0;
+	harness->format = format;
+	harness->output = setup->output;
+
+	setup_buffer(setup, &harness->send_mem, buffer_size);
+	setup_buffer(setup, &harness->recv_mem, buffer_size);
+	memset(harness->send_mem.ptr, 1, harness->send_mem.length);
+	harness->samples = (double *)malloc(sizeof(double)*harness->rounds);
+	if (harness->my_rank == 0)
+		harness->max_samples =
+		    (double *)malloc(sizeof(double)*harness->rounds);
+
+	report_info_collect(comm, &harness->info);
+	harness->info.variant = "suite";
+	harness->info.rounds = harness->rounds;
+	harness->info.iterations = 1;
+
+	if (harness->my_rank == 0) {
+		report_begin(&harness->report, format, harness->output);
+		if (format == REPORT_TEXT)
+			fprintf(harness->output, "#%-21s %10s %10s %10s %10s "
+				"%10s %10s\n", "benchmark", "bytes", "minimum",
+				"median", "75th perc", "tail", "maximum");
+	}
+}
+
+static void
+print_row(const harness_t *harness,
+	  const harness_kernel_t *kernel,
+	  uint32_t length,
+	  const stat_eval_t *stat_eval) {
+	fprintf(harness->output,
+		"%-22s %10u %10.2f %10.2f %10.2f %10.2f %10.2f\n",
+		kernel->name, length, stat_eval->minimum,
+		stat_eval->box_plot.median, stat_eval->box_plot.upper_quartil,
+		stat_eval->tail.num_percentiles
+		    ? stat_eval->tail.percentile_vals
+			  [stat_eval->tail.num_percentiles-1]
+		    : stat_eval->maximum,
+		stat_eval->maximum);
+	fflush(harness->output);
+}
+
+/* collective over the harness' communicator */
+int
+harness_measure(harness_t *harness,
+		const harness_kernel_t *kernel,
+		uint32_t length) {
+	harness_args_t args;
+	stat_eval_t stat_eval;
+	double timer;
+	int32_t round;
+	int err = 0;
+
+	args.comm = harness->comm;
+	args.my_rank = harness->my_rank;
+	args.num_ranks = harness->num_ranks;
+	args.send_buf = harness->send_mem.ptr;
+	args.recv_buf = harness->recv_mem.ptr;
+	args.length = kernel->sized ? length : 0;
+	args.state = NULL;
+
+	/* all ranks skip the kernel if any rank cannot set it up */
+	if (kernel->setup)
+		err = kernel->setup(&args);
+	MPI_Allreduce(MPI_IN_PLACE, &err, 1, MPI_INT, MPI_LOR, harness->comm);
+	if (err) {
+		if (kernel->teardown)
+			kernel->teardown(&args);
+		return -1;
+	}
+
+	for (round=-harness->warmup; round<harness->rounds; ++round) {
+		MPI_Barrier(harness->comm);
+
+		/* start timer: */
+		timer = timer_now();
+
+		kernel->run(&args);
+
+		/* stop timer: */
+		timer = timer_elapsed(timer);
+		if (round >= 0)
+			harness->samples[round] = timer*1e6/kernel->divisor;
+	}
+	if (kernel->teardown)
+		kernel->teardown(&args);
+
+	/* the round completes with the slowest rank */
+	MPI_Reduce(harness->samples, harness->max_samples, harness->rounds,
+		   MPI_DOUBLE, MPI_MAX, 0, harness->comm);
+	if (harness->my_rank != 0)
+		return 0;
+
+	statistical_eval(harness->max_samples, harness->rounds, &stat_eval);
+	if (harness->format == REPORT_TEXT) {
+		print_row(harness, kernel, args.length, &stat_eval);
+	} else {
+		harness->info.benchmark = kernel->name;
+		harness->info.length = args.length;
+		report_record(&harness->report, &harness->info, &stat_eval,
+			      harness->rounds);
+	}
+
+	return 0;
+}
+
+void
+harness_finish(harness_t *harness) {
+	if (harness->my_rank == 0)
+		report_end(&harness->report);
+	report_info_free(&harness->info);
+	free(harness->samples);
+	free(harness->max_samples);
+	buffer_free(&harness->send_mem);
+	buffer_free(&harness->recv_mem);
+}
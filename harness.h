@@ -0,0 +1,92 @@
+#ifndef _HARNESS_H
+#define _HARNESS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <mpi.h>
+
+#include <buffer.h>
+#include <report.h>
+#include <setup.h>
+#include <stat_eval.h>
+
+/*
+ * Measurement harness shared by the kernels of the suite: one pair of
+ * message buffers sized for the largest configuration, warm-up and timed
+ * rounds (each started by a barrier), the statistics and the output. The
+ * latency of a round is the completion time of the slowest rank, as in
+ * coll_lat. Text output is one table row per kernel and size; CSV and JSON
+ * records go through the report module. Buffers and the output file come
+ * from the tool's setup (see setup.h).
+ */
+typedef struct _harness_args_t {
+	MPI_Comm comm;
+	int32_t my_rank;
+	int32_t num_ranks;
+	unsigned char *send_buf;
+	unsigned char *recv_buf;
+	uint32_t length;	/* message length in bytes */
+	void *state;		/* kernel-specific, owned by setup/teardown */
+} harness_args_t;
+
+typedef struct _harness_kernel_t {
+	const char *name;
+	const char *description;
+	int32_t min_ranks;
+	bool sized;		/* false: measured once, without a payload */
+	double divisor;		/* operations per round, e.g., 2: round trip */
+	uint32_t unit;		/* bytes per element, divides all sizes */
+	/* bytes per buffer for 'length'; NULL: 'length' */
+	size_t (*buffer_size)(uint32_t length, int32_t num_ranks);
+	int (*setup)(harness_args_t *args);	/* NULL: nothing to prepare */
+	void (*run)(harness_args_t *args);	/* one timed operation */
+	void (*teardown)(harness_args_t *args);	/* NULL: nothing to release */
+} harness_kernel_t;
+
+typedef struct _harness_t {
+	MPI_Comm comm;
+	int32_t my_rank;
+	int32_t num_ranks;
+	buffer_t send_mem;
+	buffer_t recv_mem;
+	int32_t rounds;
+	int32_t warmup;
+	double *samples;
+	double *max_samples;	/* rank 0 only */
+	report_format_t format;
+	report_t report;
+	report_info_t info;
+	FILE *output;
+} harness_t;
+
+void
+harness_align_range(const harness_kernel_t *kernel,
+		    uint32_t *length,
+		    uint32_t *maxlen);
+
+size_t
+harness_buffer_size(const harness_kernel_t *kernel,
+		    uint32_t length,
+		    int32_t num_ranks);
+
+void
+harness_init(harness_t *harness,
+	     MPI_Comm comm,
+	     const setup_t *setup,
+	     size_t buffer_size,
+	     int32_t rounds,
+	     int32_t warmup,
+	     report_format_t format);
+
+int
+harness_measure(harness_t *harness,
+		const harness_kernel_t *kernel,
+		uint32_t length);
+
+void
+harness_finish(harness_t *harness);
+
+#endif /* _HARNESS_H */
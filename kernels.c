@@ -0,0 +1,162 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <bcast.h>
+#include <kernels.h>
+#include <pingpong.h>
+
+int kernels_segment = BCAST_DEFAULT_SEGMENT;
+
+/* ranks 0 and 1 ping-pong, the others only take part in the barrier */
+static void
+run_pingpong(harness_args_t *args) {
+	if (args->my_rank == 0)
+		pingpong_initiate(args->send_buf, args->recv_buf, args->length,
+				  1, args->comm, NULL);
+	else if (args->my_rank == 1)
+		pingpong_respond(args->send_buf, args->recv_buf, args->length,
+				 0, args->comm);
+}
+
+static int
+setup_persistent(harness_args_t *args) {
+	pingpong_req_t *req;
+
+	req = (pingpong_req_t *)malloc(sizeof(pingpong_req_t));
+	if (!req)
+		return -1;
+	req->send = req->recv = MPI_REQUEST_NULL;
+	args->state = req;
+	if (args->my_rank <= 1)
+		pingpong_req_init(req, args->send_buf, args->recv_buf,
+				  args->length, 1 - args->my_rank, args->comm);
+
+	return 0;
+}
+
+static void
+run_persistent(harness_args_t *args) {
+	if (args->my_rank == 0)
+		pingpong_req_initiate((pingpong_req_t *)args->state, NULL,
+				      NULL);
+	else if (args->my_rank == 1)
+		pingpong_req_respond((pingpong_req_t *)args->state, NULL);
+}
+
+static void
+teardown_persistent(harness_args_t *args) {
+	if (!args->state)
+		return;
+	pingpong_req_free((pingpong_req_t *)args->state);
+	free(args->state);
+	args->state = NULL;
+}
+
+static void
+run_barrier(harness_args_t *args) {
+	MPI_Barrier(args->comm);
+}
+
+static void
+run_bcast(harness_args_t *args) {
+	MPI_Bcast(args->send_buf, args->length, MPI_BYTE, 0, args->comm);
+}
+
+/* reductions operate on whole doubles (see the kernel's unit) */
+static void
+run_allreduce(harness_args_t *args) {
+	MPI_Allreduce(args->send_buf, args->recv_buf,
+		      args->length / sizeof(double), MPI_DOUBLE, MPI_SUM,
+		      args->comm);
+}
+
+/* 'length' bytes per rank */
+static size_t
+size_per_rank(uint32_t length, int32_t num_ranks) {
+	return (size_t)length * num_ranks;
+}
+
+static void
+run_allgather(harness_args_t *args) {
+	MPI_Allgather(args->send_buf, args->length, MPI_BYTE, args->recv_buf,
+		      args->length, MPI_BYTE, args->comm);
+}
+
+static void
+run_alltoall(harness_args_t *args) {
+	MPI_Alltoall(args->send_buf, args->length, MPI_BYTE, args->recv_buf,
+		     args->length, MPI_BYTE, args->comm);
+}
+
+static void
+run_bcast_binomial(harness_args_t *args) {
+	bcast_binomial(args->send_buf, args->length, MPI_BYTE, 0, args->comm);
+}
+
+static void
+run_bcast_chain(harness_args_t *args) {
+	bcast_chain(args->send_buf, args->length, MPI_BYTE, 0, args->comm,
+		    kernels_segment);
+}
+
+static void
+run_bcast_scatter_ring(harness_args_t *args) {
+	bcast_scatter_ring(args->send_buf, args->length, MPI_BYTE, 0,
+			   args->comm);
+}
+
+static void
+run_bcast_split_binary(harness_args_t *args) {
+	bcast_split_binary(args->send_buf, args->length, MPI_BYTE, 0,
+			   args->comm, kernels_segment);
+}
+
+static const harness_kernel_t kernels[] = {
+	{"pingpong", "blocking ping-pong between ranks 0 and 1 (half RTT)",
+	 2, true, 2, 1, NULL, NULL, run_pingpong, NULL},
+	{"pingpong_persistent", "ping-pong with persistent requests (half RTT)",
+	 2, true, 2, 1, NULL, setup_persistent, run_persistent,
+	 teardown_persistent},
+	{"barrier", "MPI_Barrier()",
+	 1, false, 1, 1, NULL, NULL, run_barrier, NULL},
+	{"bcast", "MPI_Bcast() from rank 0",
+	 1, true, 1, 1, NULL, NULL, run_bcast, NULL},
+	{"allreduce", "MPI_Allreduce() of doubles (sum)",
+	 1, true, 1, sizeof(double), NULL, NULL, run_allreduce, NULL},
+	{"allgather", "MPI_Allgather(), length bytes per rank",
+	 1, true, 1, 1, size_per_rank, NULL, run_allgather, NULL},
+	{"alltoall", "MPI_Alltoall(), length bytes per rank",
+	 1, true, 1, 1, size_per_rank, NULL, run_alltoall, NULL},
+	{"bcast_binomial", "binomial tree broadcast",
+	 1, true, 1, 1, NULL, NULL, run_bcast_binomial, NULL},
+	{"bcast_chain", "pipelined chain broadcast (segment)",
+	 1, true, 1, 1, NULL, NULL, run_bcast_chain, NULL},
+	{"bcast_scatter_ring", "scatter + ring allgather broadcast",
+	 1, true, 1, 1, NULL, NULL, run_bcast_scatter_ring, NULL},
+	{"bcast_split_binary", "split binary tree broadcast (segment)",
+	 1, true, 1, 1, NULL, NULL, run_bcast_split_binary, NULL},
+};
+
+#define NUMKERNELS	(sizeof(kernels) / sizeof(kernels[0]))
+
+uint32_t
+kernels_count(void) {
+	return NUMKERNELS;
+}
+
+const harness_kernel_t *
+kernels_get(uint32_t index) {
+	return (index < NUMKERNELS) ? &kernels[index] : NULL;
+}
+
+const harness_kernel_t *
+kernels_find(const char *name) {
+	uint32_t i;
+
+	for (i=0; i<NUMKERNELS; ++i) {
+		if (!strcmp(kernels[i].name, name))
+			return &kernels[i];
+	}
+
+	return NULL;
+}
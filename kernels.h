@@ -0,0 +1,30 @@
+#ifndef _KERNELS_H
+#define _KERNELS_H
+
+#include <stdint.h>
+
+#include <harness.h>
+
+/*
+ * Registry of the benchmark kernels run by the suite through the shared
+ * harness:
+ *   - pingpong:            blocking ping-pong between ranks 0 and 1
+ *   - pingpong_persistent: the same with persistent requests
+ *   - barrier, bcast, allreduce, allgather, alltoall: library collectives
+ *   - bcast_binomial, bcast_chain, bcast_scatter_ring, bcast_split_binary:
+ *     the point-to-point broadcasts of the bcast module
+ * Ping-pong kernels report half the round trip; collectives report the
+ * completion time of the slowest rank.
+ */
+extern int kernels_segment;	/* pipeline segment of the bcast algorithms */
+
+uint32_t
+kernels_count(void);
+
+const harness_kernel_t *
+kernels_get(uint32_t index);
+
+const harness_kernel_t *
+kernels_find(const char *name);
+
+#endif /* _KERNELS_H */
@@ -0,0 +1,341 @@
+/*
+ * Copyright 2017, Simon Pickartz Institute for Automation of Complex Power
+ * Systems,
+ *                                RWTH Aachen University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Message rate of small messages. The initiator of every pair posts a
+ * window of non-blocking sends to its partner, which pre-posts the matching
+ * receives and acknowledges the complete window. All pairs stream at the
+ * same time, so several senders per node compete for the injection and
+ * matching resources. The receives optionally use MPI_ANY_TAG and/or
+ * MPI_ANY_SOURCE. A sample is the rate over 'numwindows' windows; the report
+ * lists the median rate per sender process, per node and in total.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <mpi.h>
+
+#include <buffer.h>
+#include <pairing.h>
+#include <setup.h>
+#include <stat_eval.h>
+#include <timer.h>
+
+#define DEFAULTLEN (8)
+#define DEFAULTMAXLEN (8)
+#define DEFAULTWINDOW (64)
+#define DEFAULTWINDOWS (100)
+#define DEFAULTROUNDS (20)
+#define WARMUPROUNDS (2)
+#define DEFAULTPAIRING "neighbors"
+#define DEFAULTWILDCARD "none"
+#define ACK_TAG (32767) /* the smallest MPI_TAG_UB allowed */
+
+/* wildcards of the receives */
+#define WILDCARD_TAG (1)
+#define WILDCARD_SOURCE (2)
+
+static const char *wildcard_names[] = {"none", "tag", "source", "both"};
+#define NUMWILDCARDS (sizeof(wildcard_names) / sizeof(wildcard_names[0]))
+
+/* message buffers, one slot per message of a window */
+buffer_t send_mem, recv_mem;
+
+/* benchmark configuration */
+int32_t numrounds = DEFAULTROUNDS;
+uint32_t window = DEFAULTWINDOW;
+uint32_t numwindows = DEFAULTWINDOWS;
+uint32_t wildcards = 0;
+
+/* stream 'numwindows' windows to the partner */
+static void send_windows(MPI_Request *reqs, int32_t partner,
+			 uint32_t length) {
+	uint32_t w, i;
+
+	for (w = 0; w < numwindows; ++w) {
+		for (i = 0; i < window; ++i)
+			MPI_Isend(send_mem.ptr + (size_t)i * length, length,
+				  MPI_BYTE, partner, i, MPI_COMM_WORLD,
+				  &reqs[i]);
+		MPI_Waitall(window, reqs, MPI_STATUSES_IGNORE);
+		MPI_Recv(NULL, 0, MPI_BYTE, partner, ACK_TAG, MPI_COMM_WORLD,
+			 MPI_STATUS_IGNORE);
+	}
+}
+
+/* receive 'numwindows' windows and acknowledge each of them */
+static void recv_windows(MPI_Request *reqs, int32_t partner,
+			 uint32_t length) {
+	int source = (wildcards & WILDCARD_SOURCE) ? MPI_ANY_SOURCE : partner;
+	uint32_t w, i;
+
+	for (w = 0; w < numwindows; ++w) {
+		for (i = 0; i < window; ++i)
+			MPI_Irecv(recv_mem.ptr + (size_t)i * length, length,
+				  MPI_BYTE, source,
+				  (wildcards & WILDCARD_TAG) ? MPI_ANY_TAG
+							     : (int)i,
+				  MPI_COMM_WORLD, &reqs[i]);
+		MPI_Waitall(window, reqs, MPI_STATUSES_IGNORE);
+		MPI_Send(NULL, 0, MPI_BYTE, partner, ACK_TAG, MPI_COMM_WORLD);
+	}
+}
+
+/* median message rate (msgs/s) of this rank, 0 if unpaired */
+static double measure_rate(const pairing_t *pairing, uint32_t length,
+			   MPI_Request *reqs, double *samples) {
+	stat_eval_t stat_eval;
+	double timer;
+	int32_t round;
+
+	for (round = -WARMUPROUNDS; round < numrounds; ++round) {
+		/* all pairs stream at the same time */
+		MPI_Barrier(MPI_COMM_WORLD);
+
+		/* start timer: */
+		timer = timer_now();
+
+		if (pairing->partner < 0) {
+			/* unpaired */
+		} else if (pairing->initiator) {
+			send_windows(reqs, pairing->partner, length);
+		} else {
+			recv_windows(reqs, pairing->partner, length);
+		}
+
+		/* stop timer: */
+		timer = timer_elapsed(timer);
+		if (round >= 0)
+			samples[round] = (double)numwindows * window / timer;
+	}
+	if (pairing->partner < 0) return 0;
+	statistical_eval(samples, numrounds, &stat_eval);
+
+	return stat_eval.box_plot.median;
+}
+
+/* aggregate the per-rank rates of one size on rank 0 */
+static void print_rates(const pairing_t *pairing, const double *rates,
+			uint32_t length, FILE *output) {
+	int32_t i, pair, sender;
+	double *node_send, *node_recv;
+	double total = 0, min = 0, max_send = 0, max_recv = 0;
+
+	node_send = (double *)calloc(pairing->num_ranks, sizeof(double));
+	node_recv = (double *)calloc(pairing->num_ranks, sizeof(double));
+	for (pair = 0; pair < pairing->num_pairs; ++pair) {
+		sender = pairing->initiators[pair];
+		total += rates[sender];
+		if ((pair == 0) || (rates[sender] < min)) min = rates[sender];
+		node_send[pairing->nodes[sender]] += rates[sender];
+		node_recv[pairing->nodes[pairing->partners[sender]]] +=
+		    rates[pairing->partners[sender]];
+	}
+	for (i = 0; i < pairing->num_ranks; ++i) {
+		if (node_send[i] > max_send) max_send = node_send[i];
+		if (node_recv[i] > max_recv) max_recv = node_recv[i];
+	}
+
+	fprintf(output,
+		"%10u %8u %14.0f %14.0f %14.0f %14.0f %14.0f %10.2f\n",
+		length, window, total / pairing->num_pairs, min, max_send,
+		max_recv, total,
+		(total * length) / (1024 * 1024));
+	fflush(output);
+
+	free(node_send);
+	free(node_recv);
+}
+
+int main(int argc, char **argv) {
+	int arg;
+	uint32_t i;
+	int32_t num_ranks;
+	int32_t my_rank;
+
+	uint32_t length = DEFAULTLEN;
+	uint32_t maxlen = DEFAULTMAXLEN;
+	uint32_t cur_len;
+	pairing_mode_t pairing_mode = PAIRING_NEIGHBORS;
+	pairing_t pairing;
+	uint32_t seed = 0;
+	setup_t setup;
+	FILE *output = stdout;
+
+	MPI_Request *reqs;
+	double *samples, *rates = NULL, rate;
+
+	MPI_Init(&argc, &argv);
+	MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+	setup_init(&setup, my_rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+
+	/* determine arguments */
+	while ((arg = getopt(argc, argv,
+			     "l:L:w:n:r:W:P:s:f:h" SETUP_OPTIONS)) != -1) {
+		switch (arg) {
+			case 'l':
+				length = atoi(optarg);
+				break;
+			case 'L':
+				maxlen = atoi(optarg);
+				break;
+			case 'w':
+				window = atoi(optarg);
+				break;
+			case 'n':
+				numwindows = atoi(optarg);
+				break;
+			case 'r':
+				numrounds = atoi(optarg);
+				break;
+			case 'W':
+				for (i = 0; i < NUMWILDCARDS; ++i) {
+					if (!strcmp(optarg, wildcard_names[i]))
+						break;
+				}
+				if (i == NUMWILDCARDS) {
+					setup_abort(my_rank,
+						    "unknown wildcard '%s'",
+						    optarg);
+				}
+				wildcards = i;
+				break;
+			case 'P':
+				if (pairing_parse(optarg, &pairing_mode)) {
+					setup_abort(my_rank,
+						    "unknown pairing '%s'",
+						    optarg);
+				}
+				break;
+			case 's':
+				seed = atoi(optarg);
+				break;
+			case 'h':
+				if (my_rank == 0) {
+					printf(
+					    "usage %s [-l message_length "
+					    "(def: %d)] "
+					    "[-L max. message_length "
+					    "(def: %d)] "
+					    "[-w window depth (def: %d)] "
+					    "[-n windows per sample (def: %d)] "
+					    "[-r samples (def: %d)] "
+					    "[-W none|tag|source|both "
+					    "wildcards "
+					    "(def: %s)] "
+					    "[-P pairing (def: %s)] "
+					    "[-s seed for random pairing] ",
+					    argv[0], DEFAULTLEN, DEFAULTMAXLEN,
+					    DEFAULTWINDOW, DEFAULTWINDOWS,
+					    DEFAULTROUNDS, DEFAULTWILDCARD,
+					    DEFAULTPAIRING);
+					setup_usage(stdout, true);
+					printf("\npairings: neighbors half "
+					       "random intra inter\n");
+					fflush(stdout);
+				}
+				exit(0);
+			default:
+				setup_parse(&setup, arg, optarg);
+				break;
+		}
+	}
+
+	if (num_ranks < 2) {
+		setup_abort(my_rank, "at least 2 ranks are required");
+	}
+	if (numrounds < 1) numrounds = 1;
+	if (window < 1) window = 1;
+	if (window >= ACK_TAG) {
+		setup_abort(my_rank, "the window must be smaller than %d",
+			    ACK_TAG);
+	}
+	if (numwindows < 1) numwindows = 1;
+	if (maxlen < length) maxlen = length;
+
+	pairing_setup(MPI_COMM_WORLD, pairing_mode, seed, &pairing);
+	if (pairing.num_pairs == 0) {
+		setup_abort(my_rank, "no pairs for pairing '%s'",
+			    pairing_name(pairing_mode));
+	}
+
+	/* select and calibrate the time source */
+	setup_timer(&setup);
+
+	setup_buffer(&setup, &send_mem, (size_t)maxlen * window);
+	setup_buffer(&setup, &recv_mem, (size_t)maxlen * window);
+	memset(send_mem.ptr, 1, send_mem.length);
+	reqs = (MPI_Request *)malloc(sizeof(MPI_Request) * window);
+	samples = (double *)malloc(sizeof(double) * numrounds);
+	if (my_rank == 0) {
+		rates = (double *)malloc(sizeof(double) * num_ranks);
+	}
+
+	if (my_rank == 0) {
+		printf("Starting the benchmark:\n");
+		printf("Samples    : %10d (%u windows each)\n", numrounds,
+		       numwindows);
+		printf("Window     : %10u messages\n", window);
+		printf("Msg Length : %10d - %d\n", length, maxlen);
+		printf("Ranks      : %10d\n", num_ranks);
+		printf("Pairing    : %10s (%d pairs)\n",
+		       pairing_name(pairing_mode), pairing.num_pairs);
+		printf("Wildcards  : %10s\n", wildcard_names[wildcards]);
+		setup_print(&setup, false);
+	}
+
+	output = setup_output(&setup);
+	if (my_rank == 0) {
+		fprintf(output, "#%9s %8s %14s %14s %14s %14s %14s %10s\n",
+			"bytes", "window", "msgs/s/proc", "min/proc",
+			"send/node", "recv/node", "total", "MB/s");
+	}
+
+	cur_len = length;
+	for (;;) {
+		rate = measure_rate(&pairing, cur_len, reqs, samples);
+		MPI_Gather(&rate, 1, MPI_DOUBLE, rates, 1, MPI_DOUBLE, 0,
+			   MPI_COMM_WORLD);
+		if (my_rank == 0) print_rates(&pairing, rates, cur_len, output);
+
+		/* power-of-two sweep */
+		if (cur_len >= maxlen) break;
+		cur_len = cur_len ? cur_len * 2 : 1;
+		if (cur_len > maxlen) cur_len = maxlen;
+	}
+
+	setup_close(&setup);
+
+	free(reqs);
+	free(samples);
+	free(rates);
+	pairing_free(&pairing);
+	buffer_free(&send_mem);
+	buffer_free(&recv_mem);
+
+	MPI_Finalize();
+
+	return 0;
+}
@@ -0,0 +1,263 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <pairing.h>
+
+static const char *pairing_names[PAIRING_NUM_MODES] = {
+	"neighbors", "half", "random", "intra", "inter"
+};
+
+/* translate a mode name given on the command line */
+int
+pairing_parse(const char *name,
+	      pairing_mode_t *mode) {
+	int i;
+
+	for (i=0; i<PAIRING_NUM_MODES; ++i) {
+		if (strcmp(name, pairing_names[i]) == 0) {
+			*mode = (pairing_mode_t)i;
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+const char *
+pairing_name(pairing_mode_t mode) {
+	return (mode < PAIRING_NUM_MODES) ? pairing_names[mode] : "unknown";
+}
+
+/* pair up consecutive entries of 'order' (skipping matched nodes if asked) */
+static void
+pair_in_order(const int32_t *order,
+	      int32_t num,
+	      const int32_t *nodes,
+	      int32_t *partners) {
+	int32_t i, j;
+
+	for (i=0; i<num; ++i) {
+		if (partners[order[i]] != -1)
+			continue;
+
+		for (j=i+1; j<num; ++j) {
+			if (partners[order[j]] != -1)
+				continue;
+			if (nodes && (nodes[order[i]] == nodes[order[j]]))
+				continue;
+
+			partners[order[i]] = order[j];
+			partners[order[j]] = order[i];
+			break;
+		}
+	}
+}
+
+/* stable insertion sort of 'order' by keys[order[i]] */
+static void
+sort_by_key(int32_t *order,
+	    const int32_t *keys,
+	    int32_t num) {
+	int32_t i, j, tmp;
+
+	for (i=1; i<num; ++i) {
+		tmp = order[i];
+		for (j=i; (j>0) && (keys[order[j-1]] > keys[tmp]); --j)
+			order[j] = order[j-1];
+		order[j] = tmp;
+	}
+}
+
+/* number the pairs by ascending initiator */
+static void
+number_pairs(pairing_t *pairing,
+	     int32_t my_rank) {
+	int32_t i;
+
+	pairing->num_pairs = 0;
+	pairing->pair_id = -1;
+	for (i=0; i<pairing->num_ranks; ++i) {
+		if ((pairing->partners[i] != -1) &&
+		    (i < pairing->partners[i])) {
+			if (i == my_rank)
+				pairing->pair_id = pairing->num_pairs;
+			if (pairing->partners[i] == my_rank)
+				pairing->pair_id = pairing->num_pairs;
+			pairing->initiators[pairing->num_pairs++] = i;
+		}
+	}
+
+	pairing->partner = pairing->partners[my_rank];
+	pairing->initiator = (pairing->partner != -1) &&
+	    (my_rank < pairing->partner);
+}
+
+/* determine the pairs; every rank computes the same table */
+int
+pairing_setup(MPI_Comm comm,
+	      pairing_mode_t mode,
+	      uint32_t seed,
+	      pairing_t *pairing) {
+	int32_t i, j, tmp, my_rank, num_ranks, node_leader;
+	int32_t *order, *keys;
+	MPI_Comm node_comm;
+
+	MPI_Comm_rank(comm, &my_rank);
+	MPI_Comm_size(comm, &num_ranks);
+
+	memset(pairing, 0, sizeof(pairing_t));
+	pairing->num_ranks = num_ranks;
+	pairing->partners = (int32_t *)malloc(sizeof(int32_t)*num_ranks);
+	pairing->initiators = (int32_t *)malloc(sizeof(int32_t)*num_ranks);
+	pairing->nodes = (int32_t *)malloc(sizeof(int32_t)*num_ranks);
+	order = (int32_t *)malloc(sizeof(int32_t)*num_ranks);
+	keys = (int32_t *)malloc(sizeof(int32_t)*num_ranks);
+
+	/* identify the nodes by their lowest rank */
+	MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, my_rank,
+			    MPI_INFO_NULL, &node_comm);
+	node_leader = my_rank;
+	MPI_Bcast(&node_leader, 1, MPI_INT32_T, 0, node_comm);
+	MPI_Comm_free(&node_comm);
+	MPI_Allgather(&node_leader, 1, MPI_INT32_T, pairing->nodes, 1,
+		      MPI_INT32_T, comm);
+
+	for (i=0; i<num_ranks; ++i) {
+		pairing->partners[i] = -1;
+		order[i] = i;
+	}
+
+	switch (mode) {
+		case PAIRING_NEIGHBORS:
+			pair_in_order(order, num_ranks, NULL,
+				      pairing->partners);
+			break;
+		case PAIRING_HALF:
+			for (i=0; i<num_ranks/2; ++i) {
+				pairing->partners[i] = i+num_ranks/2;
+				pairing->partners[i+num_ranks/2] = i;
+			}
+			break;
+		case PAIRING_RANDOM:
+			/* xorshift gives the same permutation on all ranks */
+			seed = seed ? seed : 1;
+			for (i=num_ranks-1; i>0; --i) {
+				seed ^= seed << 13;
+				seed ^= seed >> 17;
+				seed ^= seed << 5;
+				j = seed % (i+1);
+				tmp = order[i];
+				order[i] = order[j];
+				order[j] = tmp;
+			}
+			pair_in_order(order, num_ranks, NULL,
+				      pairing->partners);
+			break;
+		case PAIRING_INTRA_NODE:
+			/* group the ranks by node and pair within a node */
+			sort_by_key(order, pairing->nodes, num_ranks);
+			for (i=0; i+1<num_ranks; ++i) {
+				if ((pairing->partners[order[i]] != -1) ||
+				    (pairing->nodes[order[i]] !=
+				     pairing->nodes[order[i+1]]))
+					continue;
+				pairing->partners[order[i]] = order[i+1];
+				pairing->partners[order[i+1]] = order[i];
+			}
+			break;
+		case PAIRING_INTER_NODE:
+			/* interleave the nodes: local index first, then node */
+			for (i=0; i<num_ranks; ++i) {
+				keys[i] = 0;
+				for (j=0; j<i; ++j) {
+					if (pairing->nodes[j] ==
+					    pairing->nodes[i])
+						keys[i]++;
+				}
+				keys[i] = keys[i]*num_ranks+pairing->nodes[i];
+			}
+			sort_by_key(order, keys, num_ranks);
+			pair_in_order(order, num_ranks, pairing->nodes,
+				      pairing->partners);
+			break;
+		default:
+			free(order);
+			free(keys);
+			pairing_free(pairing);
+			return -1;
+	}
+	free(keys);
+	free(order);
+
+	number_pairs(pairing, my_rank);
+
+	return 0;
+}
+
+/* the circle method needs an even number of players (one is a bye) */
+int32_t
+pairing_num_rounds(int32_t num_ranks) {
+	int32_t players = num_ranks+(num_ranks%2);
+
+	return (players > 1) ? players-1 : 0;
+}
+
+/* pair the ranks for one round of a round-robin tournament */
+int
+pairing_tournament(MPI_Comm comm,
+		   int32_t round,
+		   pairing_t *pairing) {
+	int32_t i, a, b, my_rank, players;
+
+	MPI_Comm_rank(comm, &my_rank);
+	if ((round < 0) || (round >= pairing_num_rounds(pairing->num_ranks)))
+		return -1;
+	players = pairing->num_ranks+(pairing->num_ranks%2);
+
+	for (i=0; i<pairing->num_ranks; ++i)
+		pairing->partners[i] = -1;
+
+	/* the last player is fixed, the others rotate by one per round */
+	for (i=0; i<players/2; ++i) {
+		a = (round+i)%(players-1);
+		b = i ? (round-i+players-1)%(players-1) : players-1;
+		if ((a >= pairing->num_ranks) || (b >= pairing->num_ranks))
+			continue;
+		pairing->partners[a] = b;
+		pairing->partners[b] = a;
+	}
+
+	number_pairs(pairing, my_rank);
+
+	return 0;
+}
+
+/* keep the first 'num_pairs' pairs, the other ranks become unpaired */
+int
+pairing_limit(MPI_Comm comm,
+	      int32_t num_pairs,
+	      pairing_t *pairing) {
+	int32_t pair, initiator, my_rank;
+
+	MPI_Comm_rank(comm, &my_rank);
+	if (num_pairs < 0)
+		return -1;
+
+	for (pair=num_pairs; pair<pairing->num_pairs; ++pair) {
+		initiator = pairing->initiators[pair];
+		pairing->partners[pairing->partners[initiator]] = -1;
+		pairing->partners[initiator] = -1;
+	}
+
+	number_pairs(pairing, my_rank);
+
+	return 0;
+}
+
+void
+pairing_free(pairing_t *pairing) {
+	free(pairing->partners);
+	free(pairing->initiators);
+	free(pairing->nodes);
+	memset(pairing, 0, sizeof(pairing_t));
+}
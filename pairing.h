@@ -0,0 +1,71 @@
+#ifndef _PAIRING_H
+#define _PAIRING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <mpi.h>
+
+/* 
+ * Split the ranks of a communicator into pairs that ping-pong concurrently.
+ * The lower rank of a pair is the initiator (sends the ping). With an odd
+ * number of ranks (or unmatched nodes) some ranks stay unpaired.
+ */
+typedef enum _pairing_mode_t {
+	PAIRING_NEIGHBORS = 0,	/* 0-1, 2-3, ... */
+	PAIRING_HALF,		/* i <-> i+n/2 (bisection) */
+	PAIRING_RANDOM,		/* seeded random permutation */
+	PAIRING_INTRA_NODE,	/* both ranks on the same node */
+	PAIRING_INTER_NODE,	/* ranks on different nodes */
+	PAIRING_NUM_MODES
+} pairing_mode_t;
+
+typedef struct _pairing_t {
+	int32_t num_ranks;
+	int32_t num_pairs;
+	int32_t partner;	/* -1 if the calling rank is unpaired */
+	int32_t pair_id;	/* -1 if the calling rank is unpaired */
+	bool initiator;
+	int32_t *partners;	/* partner of every rank (or -1) */
+	int32_t *initiators;	/* initiator of every pair, ascending */
+	int32_t *nodes;		/* node id (lowest rank on the node) */
+} pairing_t;
+
+int
+pairing_parse(const char *name, 
+	      pairing_mode_t *mode);
+
+const char *
+pairing_name(pairing_mode_t mode);
+
+int
+pairing_setup(MPI_Comm comm,
+	      pairing_mode_t mode,
+	      uint32_t seed,
+	      pairing_t *pairing);
+
+/*
+ * Round-robin tournament over all ranks (circle method): after
+ * pairing_setup(), pairing_tournament() re-pairs the ranks for the given
+ * round so that every pair of ranks meets exactly once within
+ * pairing_num_rounds() rounds and each rank is in at most one pair per
+ * round. With an odd number of ranks one rank sits out every round.
+ */
+int32_t
+pairing_num_rounds(int32_t num_ranks);
+
+int
+pairing_tournament(MPI_Comm comm,
+		   int32_t round,
+		   pairing_t *pairing);
+
+/* keep the first 'num_pairs' pairs only, e.g., one measured pair */
+int
+pairing_limit(MPI_Comm comm,
+	      int32_t num_pairs,
+	      pairing_t *pairing);
+
+void
+pairing_free(pairing_t *pairing);
+
+#endif /* _PAIRING_H */
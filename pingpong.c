@@ -0,0 +1,85 @@
+#include <pingpong.h>
+#include <timer.h>
+
+void
+pingpong_initiate(const void *send,
+		  void *recv,
+		  uint32_t length,
+		  int32_t partner,
+		  MPI_Comm comm,
+		  double *send_time) {
+	double timer = 0;
+
+	if (send_time)
+		timer = timer_now();
+	MPI_Send(send, length, MPI_CHAR, partner, PINGPONG_TAG, comm);
+	if (send_time)
+		*send_time = timer_elapsed(timer);
+	MPI_Recv(recv, length, MPI_CHAR, partner, PINGPONG_TAG, comm,
+		 MPI_STATUS_IGNORE);
+}
+
+void
+pingpong_respond(const void *send,
+		 void *recv,
+		 uint32_t length,
+		 int32_t partner,
+		 MPI_Comm comm) {
+	MPI_Recv(recv, length, MPI_CHAR, partner, PINGPONG_TAG, comm,
+		 MPI_STATUS_IGNORE);
+	MPI_Send(send, length, MPI_CHAR, partner, PINGPONG_TAG, comm);
+}
+
+/* persistent requests; the buffers must not overlap */
+void
+pingpong_req_init(pingpong_req_t *req,
+		  const void *send,
+		  void *recv,
+		  uint32_t length,
+		  int32_t partner,
+		  MPI_Comm comm) {
+	MPI_Send_init(send, length, MPI_CHAR, partner, PINGPONG_TAG, comm,
+		      &req->send);
+	MPI_Recv_init(recv, length, MPI_CHAR, partner, PINGPONG_TAG, comm,
+		      &req->recv);
+}
+
+static void
+req_send(pingpong_req_t *req,
+	 pingpong_ready_t ready) {
+	MPI_Start(&req->send);
+	if (ready)
+		ready(req->send);
+	MPI_Wait(&req->send, MPI_STATUS_IGNORE);
+}
+
+void
+pingpong_req_initiate(pingpong_req_t *req,
+		      pingpong_ready_t ready,
+		      double *send_time) {
+	double timer = 0;
+
+	MPI_Start(&req->recv);
+	if (send_time)
+		timer = timer_now();
+	req_send(req, ready);
+	if (send_time)
+		*send_time = timer_elapsed(timer);
+	MPI_Wait(&req->recv, MPI_STATUS_IGNORE);
+}
+
+void
+pingpong_req_respond(pingpong_req_t *req,
+		     pingpong_ready_t ready) {
+	MPI_Start(&req->recv);
+	MPI_Wait(&req->recv, MPI_STATUS_IGNORE);
+	req_send(req, ready);
+}
+
+void
+pingpong_req_free(pingpong_req_t *req) {
+	if (req->send != MPI_REQUEST_NULL)
+		MPI_Request_free(&req->send);
+	if (req->recv != MPI_REQUEST_NULL)
+		MPI_Request_free(&req->recv);
+}
@@ -0,0 +1,64 @@
+#ifndef _PINGPONG_H
+#define _PINGPONG_H
+
+#include <stdint.h>
+
+#include <mpi.h>
+
+/*
+ * Round trips shared by the ping-pong tools and the suite. The initiator
+ * sends the ping and receives the pong, the responder mirrors it:
+ *   - pingpong_initiate()/pingpong_respond(): MPI_Send()/MPI_Recv()
+ *   - pingpong_req_*(): requests set up once (e.g., MPI_Send_init()); the
+ *     initiator starts the receive of the pong before the ping, the
+ *     responder starts its receive when it waits for the ping; 'ready' is
+ *     called between starting and completing the send (e.g., MPI_Pready()
+ *     of partitions)
+ * pingpong_initiate() and pingpong_req_initiate() store the duration of
+ * the send phase in seconds if 'send_time' is not NULL.
+ */
+#define PINGPONG_TAG	(0)
+
+typedef struct _pingpong_req_t {
+	MPI_Request send;
+	MPI_Request recv;
+} pingpong_req_t;
+
+typedef void (*pingpong_ready_t)(MPI_Request request);
+
+void
+pingpong_initiate(const void *send,
+		  void *recv,
+		  uint32_t length,
+		  int32_t partner,
+		  MPI_Comm comm,
+		  double *send_time);
+
+void
+pingpong_respond(const void *send,
+		 void *recv,
+		 uint32_t length,
+		 int32_t partner,
+		 MPI_Comm comm);
+
+void
+pingpong_req_init(pingpong_req_t *req,
+		  const void *send,
+		  void *recv,
+		  uint32_t length,
+		  int32_t partner,
+		  MPI_Comm comm);
+
+void
+pingpong_req_initiate(pingpong_req_t *req,
+		      pingpong_ready_t ready,
+		      double *send_time);
+
+void
+pingpong_req_respond(pingpong_req_t *req,
+		     pingpong_ready_t ready);
+
+void
+pingpong_req_free(pingpong_req_t *req);
+
+#endif /* _PINGPONG_H */
@@ -0,0 +1,558 @@
+/*
+ * Copyright 2017, Simon Pickartz Institute for Automation of Complex Power
+ * Systems,
+ *                                RWTH Aachen University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Cost of non-contiguous transfers. Ranks 0 and 1 ping-pong a strided face
+ * of 'count' blocks of 'blocklen' doubles whose starts are 'stride' doubles
+ * apart, as in a halo exchange. The face is either described by a derived
+ * datatype (vector, indexed, subarray) or packed into a contiguous buffer
+ * (scalar or SIMD loops, MPI_Pack()) before sending and unpacked after
+ * receiving. The contiguous transfer of the same payload is the reference:
+ * the cost column is the latency relative to it.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <mpi.h>
+
+#include <buffer.h>
+#include <setup.h>
+#include <stat_eval.h>
+#include <timer.h>
+
+#define DEFAULTLEN (8)
+#define DEFAULTMAXLEN (1024 * 1024)
+#define DEFAULTSTRIDES "2,16"
+#define DEFAULTBLOCKLEN (1)
+#define DEFAULTVARIANTS "all"
+#define DEFAULTROUNDS (1000)
+#define WARMUPROUNDS (100)
+#define MAXSTRIDES (16)
+#define MAXVARIANTS (8)
+#define DDT_TAG (4711)
+
+/* keep the compiler from vectorizing the reference pack loops */
+#if defined(__clang__)
+#define NOVECTOR _Pragma("clang loop vectorize(disable)")
+#define SCALAR_FUNC
+#elif defined(__GNUC__)
+#define NOVECTOR
+#define SCALAR_FUNC __attribute__((optimize("no-tree-vectorize")))
+#else
+#define NOVECTOR
+#define SCALAR_FUNC
+#endif
+
+/* a face of the current size and stride in all its representations */
+typedef struct _layout_t {
+	int count;
+	int blocklen;
+	int stride;
+	double *pack;		/* contiguous scratch buffer */
+	int pack_bytes;		/* upper bound of MPI_Pack() */
+	MPI_Datatype vector;
+	MPI_Datatype indexed;
+	MPI_Datatype subarray;
+} layout_t;
+
+/* a way to transfer the face; 'buf' points to the strided layout */
+typedef struct _ddt_kernel_t {
+	const char *name;
+	void (*send)(layout_t *l, double *buf, int peer);
+	void (*recv)(layout_t *l, double *buf, int peer);
+	bool contiguous;	/* payload at the start of 'buf' */
+} ddt_kernel_t;
+
+static void send_contig(layout_t *l, double *buf, int peer) {
+	MPI_Send(buf, l->count * l->blocklen, MPI_DOUBLE, peer, DDT_TAG,
+		 MPI_COMM_WORLD);
+}
+
+static void recv_contig(layout_t *l, double *buf, int peer) {
+	MPI_Recv(buf, l->count * l->blocklen, MPI_DOUBLE, peer, DDT_TAG,
+		 MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+}
+
+static void send_vector(layout_t *l, double *buf, int peer) {
+	MPI_Send(buf, 1, l->vector, peer, DDT_TAG, MPI_COMM_WORLD);
+}
+
+static void recv_vector(layout_t *l, double *buf, int peer) {
+	MPI_Recv(buf, 1, l->vector, peer, DDT_TAG, MPI_COMM_WORLD,
+		 MPI_STATUS_IGNORE);
+}
+
+static void send_indexed(layout_t *l, double *buf, int peer) {
+	MPI_Send(buf, 1, l->indexed, peer, DDT_TAG, MPI_COMM_WORLD);
+}
+
+static void recv_indexed(layout_t *l, double *buf, int peer) {
+	MPI_Recv(buf, 1, l->indexed, peer, DDT_TAG, MPI_COMM_WORLD,
+		 MPI_STATUS_IGNORE);
+}
+
+static void send_subarray(layout_t *l, double *buf, int peer) {
+	MPI_Send(buf, 1, l->subarray, peer, DDT_TAG, MPI_COMM_WORLD);
+}
+
+static void recv_subarray(layout_t *l, double *buf, int peer) {
+	MPI_Recv(buf, 1, l->subarray, peer, DDT_TAG, MPI_COMM_WORLD,
+		 MPI_STATUS_IGNORE);
+}
+
+static SCALAR_FUNC void pack_scalar(layout_t *l, const double *buf) {
+	int i, j;
+
+	for (i = 0; i < l->count; ++i) {
+		NOVECTOR
+		for (j = 0; j < l->blocklen; ++j)
+			l->pack[(size_t)i * l->blocklen + j] =
+			    buf[(size_t)i * l->stride + j];
+	}
+}
+
+static SCALAR_FUNC void unpack_scalar(layout_t *l, double *buf) {
+	int i, j;
+
+	for (i = 0; i < l->count; ++i) {
+		NOVECTOR
+		for (j = 0; j < l->blocklen; ++j)
+			buf[(size_t)i * l->stride + j] =
+			    l->pack[(size_t)i * l->blocklen + j];
+	}
+}
+
+/* single elements are gathered across blocks, longer blocks are copied */
+static void pack_simd(layout_t *l, const double *buf) {
+	int i, j;
+
+	if (l->blocklen == 1) {
+#pragma omp simd
+		for (i = 0; i < l->count; ++i)
+			l->pack[i] = buf[(size_t)i * l->stride];
+		return;
+	}
+	for (i = 0; i < l->count; ++i) {
+		const double *src = &buf[(size_t)i * l->stride];
+		double *dst = &l->pack[(size_t)i * l->blocklen];
+#pragma omp simd
+		for (j = 0; j < l->blocklen; ++j) dst[j] = src[j];
+	}
+}
+
+static void unpack_simd(layout_t *l, double *buf) {
+	int i, j;
+
+	if (l->blocklen == 1) {
+#pragma omp simd
+		for (i = 0; i < l->count; ++i)
+			buf[(size_t)i * l->stride] = l->pack[i];
+		return;
+	}
+	for (i = 0; i < l->count; ++i) {
+		const double *src = &l->pack[(size_t)i * l->blocklen];
+		double *dst = &buf[(size_t)i * l->stride];
+#pragma omp simd
+		for (j = 0; j < l->blocklen; ++j) dst[j] = src[j];
+	}
+}
+
+static void send_scalar(layout_t *l, double *buf, int peer) {
+	pack_scalar(l, buf);
+	send_contig(l, l->pack, peer);
+}
+
+static void recv_scalar(layout_t *l, double *buf, int peer) {
+	recv_contig(l, l->pack, peer);
+	unpack_scalar(l, buf);
+}
+
+static void send_simd(layout_t *l, double *buf, int peer) {
+	pack_simd(l, buf);
+	send_contig(l, l->pack, peer);
+}
+
+static void recv_simd(layout_t *l, double *buf, int peer) {
+	recv_contig(l, l->pack, peer);
+	unpack_simd(l, buf);
+}
+
+static void send_mpi_pack(layout_t *l, double *buf, int peer) {
+	int position = 0;
+
+	MPI_Pack(buf, 1, l->vector, l->pack, l->pack_bytes, &position,
+		 MPI_COMM_WORLD);
+	MPI_Send(l->pack, position, MPI_PACKED, peer, DDT_TAG,
+		 MPI_COMM_WORLD);
+}
+
+static void recv_mpi_pack(layout_t *l, double *buf, int peer) {
+	int position = 0;
+
+	MPI_Recv(l->pack, l->pack_bytes, MPI_PACKED, peer, DDT_TAG,
+		 MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+	MPI_Unpack(l->pack, l->pack_bytes, &position, buf, 1, l->vector,
+		   MPI_COMM_WORLD);
+}
+
+/* the reference comes first and is always measured */
+static const ddt_kernel_t ddt_kernels[] = {
+    {"contig", send_contig, recv_contig, true},
+    {"vector", send_vector, recv_vector, false},
+    {"indexed", send_indexed, recv_indexed, false},
+    {"subarray", send_subarray, recv_subarray, false},
+    {"pack_scalar", send_scalar, recv_scalar, false},
+    {"pack_simd", send_simd, recv_simd, false},
+    {"mpi_pack", send_mpi_pack, recv_mpi_pack, false},
+};
+#define NUMKERNELS (sizeof(ddt_kernels) / sizeof(ddt_kernels[0]))
+
+/* strided layouts, sized for the largest face and stride */
+buffer_t send_mem, recv_mem;
+
+/* benchmark configuration */
+int32_t numrounds = DEFAULTROUNDS;
+
+static void layout_create(layout_t *l, int count, int blocklen, int stride) {
+	int *blocklens, *displs, i;
+	int sizes[2], subsizes[2], starts[2] = {0, 0};
+
+	l->count = count;
+	l->blocklen = blocklen;
+	l->stride = stride;
+
+	MPI_Type_vector(count, blocklen, stride, MPI_DOUBLE, &l->vector);
+	MPI_Type_commit(&l->vector);
+
+	blocklens = (int *)malloc(sizeof(int) * count);
+	displs = (int *)malloc(sizeof(int) * count);
+	for (i = 0; i < count; ++i) {
+		blocklens[i] = blocklen;
+		displs[i] = i * stride;
+	}
+	MPI_Type_indexed(count, blocklens, displs, MPI_DOUBLE, &l->indexed);
+	MPI_Type_commit(&l->indexed);
+	free(blocklens);
+	free(displs);
+
+	/* the first 'blocklen' columns of a count x stride array */
+	sizes[0] = count;
+	sizes[1] = stride;
+	subsizes[0] = count;
+	subsizes[1] = blocklen;
+	MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_C,
+				 MPI_DOUBLE, &l->subarray);
+	MPI_Type_commit(&l->subarray);
+
+	MPI_Pack_size(1, l->vector, MPI_COMM_WORLD, &l->pack_bytes);
+}
+
+static void layout_free(layout_t *l) {
+	MPI_Type_free(&l->vector);
+	MPI_Type_free(&l->indexed);
+	MPI_Type_free(&l->subarray);
+}
+
+/* true if the echoed face matches the one sent */
+static bool layout_verify(const layout_t *l, const ddt_kernel_t *kernel,
+			  const double *sent, const double *received) {
+	int i, j;
+	size_t pos;
+
+	for (i = 0; i < l->count; ++i) {
+		for (j = 0; j < l->blocklen; ++j) {
+			pos = kernel->contiguous
+				  ? (size_t)i * l->blocklen + j
+				  : (size_t)i * l->stride + j;
+			if (sent[pos] != received[pos]) return false;
+		}
+	}
+
+	return true;
+}
+
+/* median one-way latency (usec) of a kernel; valid on rank 0 only */
+static double measure_kernel(const ddt_kernel_t *kernel, layout_t *l,
+			     int32_t my_rank, double *samples, bool *valid) {
+	double *send_buf = (double *)send_mem.ptr;
+	double *recv_buf = (double *)recv_mem.ptr;
+	stat_eval_t stat_eval;
+	double timer;
+	int32_t round;
+
+	memset(recv_buf, 0, recv_mem.length);
+	MPI_Barrier(MPI_COMM_WORLD);
+
+	for (round = -WARMUPROUNDS; round < numrounds; ++round) {
+		if (my_rank == 0) {
+			/* start timer: */
+			timer = timer_now();
+
+			kernel->send(l, send_buf, 1);
+			kernel->recv(l, recv_buf, 1);
+
+			/* stop timer: */
+			timer = timer_elapsed(timer);
+			if (round >= 0) samples[round] = timer * 1e6 / 2;
+		} else if (my_rank == 1) {
+			/* echo the face from the receive layout */
+			kernel->recv(l, recv_buf, 0);
+			kernel->send(l, recv_buf, 0);
+		}
+	}
+
+	if (my_rank != 0) return 0;
+
+	*valid = layout_verify(l, kernel, send_buf, recv_buf);
+	statistical_eval(samples, numrounds, &stat_eval);
+
+	return stat_eval.box_plot.median;
+}
+
+/* parse a comma-separated list of positive integers */
+static uint32_t parse_list(char *list, int32_t *vals, uint32_t max_vals) {
+	uint32_t num_vals = 0;
+	char *val;
+
+	for (val = strtok(list, ","); val && (num_vals < max_vals);
+	     val = strtok(NULL, ","))
+		vals[num_vals++] = atoi(val);
+
+	return num_vals;
+}
+
+int main(int argc, char **argv) {
+	int arg;
+	uint32_t i, j, s;
+	int32_t num_ranks;
+	int32_t my_rank;
+
+	uint32_t length = DEFAULTLEN;
+	uint32_t maxlen = DEFAULTMAXLEN;
+	uint32_t cur_len;
+	int32_t blocklen = DEFAULTBLOCKLEN;
+	int32_t strides[MAXSTRIDES];
+	int32_t max_stride = 0;
+	uint32_t num_strides;
+	char *stride_list = DEFAULTSTRIDES;
+	char *variants = DEFAULTVARIANTS;
+	char *variant;
+	const ddt_kernel_t *kernels[MAXVARIANTS];
+	uint32_t num_kernels = 0;
+	layout_t layout;
+	int count;
+	size_t extent;
+	setup_t setup;
+	FILE *output = stdout;
+
+	double *samples;
+	double median, reference = 0, bytes;
+	bool valid = true;
+
+	MPI_Init(&argc, &argv);
+	MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+	setup_init(&setup, my_rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+
+	/* determine arguments */
+	while ((arg = getopt(argc, argv,
+			     "v:l:L:s:b:r:f:h" SETUP_OPTIONS)) != -1) {
+		switch (arg) {
+			case 'v':
+				variants = optarg;
+				break;
+			case 'l':
+				length = atoi(optarg);
+				break;
+			case 'L':
+				maxlen = atoi(optarg);
+				break;
+			case 's':
+				stride_list = optarg;
+				break;
+			case 'b':
+				blocklen = atoi(optarg);
+				break;
+			case 'r':
+				numrounds = atoi(optarg);
+				break;
+			case 'h':
+				if (my_rank == 0) {
+					printf(
+					    "usage %s [-v variants|all "
+					    "(def: %s)] "
+					    "[-l payload_length (def: %d)] "
+					    "[-L max. payload_length "
+					    "(def: %d)] "
+					    "[-s strides in doubles (def: %s)] "
+					    "[-b block length in doubles "
+					    "(def: %d)] "
+					    "[-r rounds (def: %d)] ",
+					    argv[0], DEFAULTVARIANTS,
+					    DEFAULTLEN, DEFAULTMAXLEN,
+					    DEFAULTSTRIDES, DEFAULTBLOCKLEN,
+					    DEFAULTROUNDS);
+					setup_usage(stdout, true);
+					printf("\nvariants:");
+					for (i = 0; i < NUMKERNELS; ++i)
+						printf(" %s",
+						       ddt_kernels[i].name);
+					printf("\n");
+					fflush(stdout);
+				}
+				exit(0);
+			default:
+				setup_parse(&setup, arg, optarg);
+				break;
+		}
+	}
+
+	if (num_ranks < 2) {
+		setup_abort(my_rank, "at least 2 ranks are required");
+	}
+	if (numrounds < 1) numrounds = 1;
+	if (blocklen < 1) blocklen = 1;
+
+	/* resolve the variants; the contiguous reference is always measured */
+	kernels[num_kernels++] = &ddt_kernels[0];
+	variants = strdup(variants);
+	if (strcmp(variants, "all") == 0) {
+		for (i = 1; i < NUMKERNELS; ++i)
+			kernels[num_kernels++] = &ddt_kernels[i];
+	} else {
+		for (variant = strtok(variants, ","); variant;
+		     variant = strtok(NULL, ",")) {
+			for (j = 0; j < NUMKERNELS; ++j) {
+				if (strcmp(variant, ddt_kernels[j].name) == 0)
+					break;
+			}
+			if ((j == NUMKERNELS) || (num_kernels == MAXVARIANTS)) {
+				setup_abort(my_rank, "unknown variant '%s'",
+					    variant);
+			}
+			if (j > 0) kernels[num_kernels++] = &ddt_kernels[j];
+		}
+	}
+
+	stride_list = strdup(stride_list);
+	num_strides = parse_list(stride_list, strides, MAXSTRIDES);
+	for (s = 0; s < num_strides; ++s) {
+		if (strides[s] < blocklen) {
+			setup_abort(my_rank, "stride %d is shorter than the "
+				    "block length %d", strides[s], blocklen);
+		}
+		if (strides[s] > max_stride) max_stride = strides[s];
+	}
+	if (num_strides == 0) {
+		setup_abort(my_rank, "no strides given");
+	}
+	if (length < sizeof(double) * blocklen)
+		length = sizeof(double) * blocklen;
+	if (maxlen < length) maxlen = length;
+
+	/* select and calibrate the time source */
+	setup_timer(&setup);
+
+	/* the strided layout spans 'stride' doubles per block */
+	count = maxlen / (sizeof(double) * blocklen);
+	extent = (size_t)count * max_stride * sizeof(double);
+	setup_buffer(&setup, &send_mem, extent);
+	setup_buffer(&setup, &recv_mem, extent);
+	for (i = 0; i < extent / sizeof(double); ++i)
+		((double *)send_mem.ptr)[i] = i;
+	layout.pack =
+	    (double *)malloc((size_t)count * blocklen * sizeof(double));
+	samples = (double *)malloc(sizeof(double) * numrounds);
+
+	if (my_rank == 0) {
+		printf("Starting the benchmark:\n");
+		printf("Rounds     : %10d\n", numrounds);
+		printf("Payload    : %10d - %d\n", length, maxlen);
+		printf("Block      : %10d doubles\n", blocklen);
+		printf("Strides    :");
+		for (s = 0; s < num_strides; ++s) printf(" %d", strides[s]);
+		printf(" doubles\n");
+		setup_print(&setup, false);
+	}
+
+	output = setup_output(&setup);
+	if (my_rank == 0) {
+		fprintf(output, "#%-15s %8s %10s %10s %10s %10s\n", "variant",
+			"stride", "bytes", "latency", "MB/s", "cost");
+	}
+
+	for (s = 0; s < num_strides; ++s) {
+		cur_len = length;
+		for (;;) {
+			count = cur_len / (sizeof(double) * blocklen);
+			bytes = (double)count * blocklen * sizeof(double);
+			layout_create(&layout, count, blocklen, strides[s]);
+
+			for (i = 0; i < num_kernels; ++i) {
+				median = measure_kernel(kernels[i], &layout,
+							my_rank, samples,
+							&valid);
+				if (my_rank != 0) continue;
+
+				if (!valid) {
+					fprintf(stderr,
+						"ERROR: %s corrupted the face "
+						"(stride %d, %.0f bytes). "
+						"Abort!\n", kernels[i]->name,
+						strides[s], bytes);
+					MPI_Abort(MPI_COMM_WORLD, -1);
+				}
+				if (i == 0) reference = median;
+				fprintf(output,
+					"%-16s %8d %10.0f %10.2f %10.2f "
+					"%10.2f\n",
+					kernels[i]->name, strides[s], bytes,
+					median,
+					(bytes / (median * 1e-6)) /
+					    (1024 * 1024),
+					median / reference);
+				fflush(output);
+			}
+			layout_free(&layout);
+
+			/* power-of-two sweep */
+			if (cur_len >= maxlen) break;
+			cur_len *= 2;
+			if (cur_len > maxlen) cur_len = maxlen;
+		}
+	}
+
+	setup_close(&setup);
+
+	free(variants);
+	free(stride_list);
+	free(samples);
+	free(layout.pack);
+	buffer_free(&send_mem);
+	buffer_free(&recv_mem);
+
+	MPI_Finalize();
+
+	return 0;
+}
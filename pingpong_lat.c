@@ -21,6 +21,8 @@
  */
 
 #include <errno.h>
+#include <math.h>
+#include <signal.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -31,198 +33,1101 @@
 
 #include <mpi.h>
 
+#include <adaptive.h>
+#include <buffer.h>
+#include <cache.h>
+#include <congestion.h>
+#include <pairing.h>
+#include <pingpong.h>
+#include <report.h>
+#include <ringlog.h>
+#include <setup.h>
 #include <stat_eval.h>
+#include <timer.h>
 
 #undef _WATCH_DOG_
-#define _CACHE_WARM_UP_
 #undef _USE_SEPARATED_BUFFERS_
-#undef _PRINT_INDIVIDUAL_RES_
 
-#define MAXBUFSIZE (64)
 #define DEFAULTLEN (0)
 #define DEFAULTROUNDS (10000)
+#define ADAPTIVEMAXROUNDS (1000000)
 #define DEFAULTITER (1)
 #define WARMUPITER (10000)
+#define STOPCHECKROUNDS (1000)
+#define SUMMARYVALS (6)
+#define DEFAULTPAIRING "neighbors"
+#define OUTLIERZ (3.5)
+#define DEFAULTLOADLEVELS "0,100,1000,max"
+#define MAXLOADLEVELS (16)
 
-#ifdef _USE_SEPARATED_BUFFERS_
-unsigned char send_buffer[MAXBUFSIZE + 1];
-unsigned char recv_buffer[MAXBUFSIZE + 1];
-#else
-#define send_buffer buffer
-#define recv_buffer buffer
-unsigned char buffer[MAXBUFSIZE + 1];
-#endif
+/* message buffers (recv_buffer aliases send_buffer unless separated) */
+buffer_t send_mem, recv_mem;
+unsigned char *send_buffer = NULL;
+unsigned char *recv_buffer = NULL;
 unsigned char dummy = 0;
 
+/* per-round output, if requested */
+ringlog_t *round_log = NULL;
+
+/* stop criterion of adaptive runs, if requested */
+adaptive_t *adaptive = NULL;
+
+/* set by the signal handler to terminate infinite runs */
+volatile sig_atomic_t stop_requested = 0;
+
+static void stop_handler(int signum) {
+	(void)signum;
+	stop_requested = 1;
+}
+
+/* print the per-pair statistics gathered on rank 0 */
+static void print_pair_breakdown(const pairing_t *pairing,
+				 const double *summaries, uint32_t length,
+				 FILE *output) {
+	int32_t pair, initiator, partner;
+	double bandwidth, aggregate = 0;
+
+	fprintf(output, "##----------------------------------------------\n");
+	fprintf(output, "#Pair  Ranks        Nodes          Minimum     Median"
+			"       Tail    Maximum       MB/s\n");
+	for (pair = 0; pair < pairing->num_pairs; ++pair) {
+		initiator = pairing->initiators[pair];
+		partner = pairing->partners[initiator];
+		const double *vals = &summaries[initiator * SUMMARYVALS];
+
+		bandwidth = (length / (vals[1] * 1e-6)) / (1024 * 1024);
+		aggregate += bandwidth;
+		fprintf(output,
+			"#%-5d %5d-%-5d  %5d-%-5d %10.2f %10.2f %10.2f %10.2f "
+			"%10.2f\n",
+			pair, initiator, partner, pairing->nodes[initiator],
+			pairing->nodes[partner], vals[0], vals[1], vals[2],
+			vals[3], bandwidth);
+	}
+	fprintf(output, "#Aggregate MB/s %10.2f\n", aggregate);
+}
+
+/* agree on the termination of infinite runs; true once any rank got a signal */
+static bool stop_agreed(void) {
+	int32_t stop = stop_requested;
+
+	MPI_Allreduce(MPI_IN_PLACE, &stop, 1, MPI_INT32_T, MPI_LOR,
+		      MPI_COMM_WORLD);
+	return stop;
+}
+
+/*
+ * the initiator times each round after establishing the cache state;
+ * returns the number of completed rounds
+ */
+static int64_t initiator_rounds(cache_t *cache, int32_t remote_rank,
+			     uint32_t length, uint32_t iterations,
+			     int32_t numrounds, bool run_infinitely,
+			     double *time_stamps, stream_eval_t *stream_eval) {
+	uint32_t i;
+	int64_t round;
+	double timer;
+	MPI_Status status;
+
+	for (i = 0; i < WARMUPITER; ++i)
+		pingpong_initiate(cache->send, cache->recv, length,
+				  remote_rank, MPI_COMM_WORLD, NULL);
+	MPI_Barrier(MPI_COMM_WORLD);
+
+	for (round = 0; run_infinitely || (round < numrounds); ++round) {
+		if (round_log) ringlog_flush(round_log, false);
+
+		/* the partner signals that its buffers are cold as well */
+		cache_prepare(cache);
+		if (cache->mode == CACHE_COLD)
+			MPI_Recv(&dummy, 0, MPI_CHAR, remote_rank, 1,
+				 MPI_COMM_WORLD, &status);
+
+		/* start timer: */
+		timer = timer_now();
+
+		for (i = 0; i < iterations; ++i)
+			pingpong_initiate(cache->send, cache->recv, length,
+					  remote_rank, MPI_COMM_WORLD, NULL);
+
+		/* stop timer: */
+		timer = timer_elapsed(timer);
+		if (run_infinitely == false)
+			time_stamps[round] = timer * 1e6 / (2 * iterations);
+		else
+			stream_eval_add(stream_eval,
+					timer * 1e6 / (2 * iterations));
+		if (round_log)
+			ringlog_put(round_log, length,
+				    timer / (2.0 * iterations) * 1e6,
+				    (length / (timer / (2.0 * iterations))) /
+					(1024 * 1024),
+				    0);
+#ifdef _WATCH_DOG_
+		if (!(round % 100000)) printf("Round %" PRId64 " ...\n", round);
+#endif
+
+		if (run_infinitely && !((round + 1) % STOPCHECKROUNDS) &&
+		    stop_agreed())
+			break;
+		if (adaptive && adaptive_check(adaptive, MPI_COMM_WORLD,
+					       round + 1, time_stamps,
+					       round + 1)) {
+			round++;
+			break;
+		}
+	}
+
+	return round;
+}
+
+/* the partner mirrors the initiator */
+static int64_t responder_rounds(cache_t *cache, int32_t remote_rank,
+			     uint32_t length, uint32_t iterations,
+			     int32_t numrounds, bool run_infinitely) {
+	uint32_t i;
+	int64_t round;
+
+	for (i = 0; i < WARMUPITER; ++i)
+		pingpong_respond(cache->send, cache->recv, length,
+				 remote_rank, MPI_COMM_WORLD);
+	MPI_Barrier(MPI_COMM_WORLD);
+
+	for (round = 0; run_infinitely || (round < numrounds); ++round) {
+		cache_prepare(cache);
+		if (cache->mode == CACHE_COLD)
+			MPI_Send(&dummy, 0, MPI_CHAR, remote_rank, 1,
+				 MPI_COMM_WORLD);
+
+		for (i = 0; i < iterations; ++i)
+			pingpong_respond(cache->send, cache->recv, length,
+					 remote_rank, MPI_COMM_WORLD);
+
+		if (run_infinitely && !((round + 1) % STOPCHECKROUNDS) &&
+		    stop_agreed())
+			break;
+		if (adaptive && adaptive_check(adaptive, MPI_COMM_WORLD,
+					       round + 1, NULL, 0)) {
+			round++;
+			break;
+		}
+	}
+
+	return round;
+}
+
+/* unpaired ranks only take part in the synchronization */
+static int64_t idle_rounds(int32_t numrounds, bool run_infinitely) {
+	int64_t round;
+
+	MPI_Barrier(MPI_COMM_WORLD);
+	if (!run_infinitely && !adaptive) return numrounds;
+	for (round = 0; run_infinitely || (round < numrounds); ++round) {
+		if (run_infinitely && !((round + 1) % STOPCHECKROUNDS) &&
+		    stop_agreed())
+			break;
+		if (adaptive && adaptive_check(adaptive, MPI_COMM_WORLD,
+					       round + 1, NULL, 0)) {
+			round++;
+			break;
+		}
+	}
+
+	return round;
+}
+
+/*
+ * Statistical evaluation: every initiator evaluates its pair, rank 0
+ * additionally evaluates the pooled samples of all pairs and receives the
+ * per-pair summaries. The pooled samples are dumped to 'raw' (if given)
+ * before the evaluation reorders them.
+ */
+static void evaluate_rounds(const pairing_t *pairing, int32_t numrounds,
+			    bool run_infinitely, double *time_stamps,
+			    stream_eval_t *stream_eval, double *summaries,
+			    stat_eval_t *stat_eval, uint64_t *count,
+			    const report_info_t *info, FILE *raw) {
+	int32_t pair, my_rank, num_ranks;
+	double summary[SUMMARYVALS];
+	double *pooled_stamps = NULL;
+	int *pooled_counts = NULL;
+	int *pooled_displs = NULL;
+	stream_eval_t *pooled_stream = NULL;
+	MPI_Status status;
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+	memset(summary, 0, sizeof(summary));
+
+	if (run_infinitely == true) {
+		if (pairing->initiator)
+			stream_eval_finalize(stream_eval, stat_eval);
+
+		/* merge the estimators of all pairs on rank 0 */
+		if (my_rank == 0) {
+			pooled_stream =
+			    (stream_eval_t *)malloc(sizeof(stream_eval_t));
+			stream_eval_init(pooled_stream);
+			for (pair = 0; pair < pairing->num_pairs; ++pair) {
+				if (pairing->initiators[pair] == 0) {
+					stream_eval_merge(pooled_stream,
+							  stream_eval);
+					continue;
+				}
+				MPI_Recv(stream_eval, sizeof(stream_eval_t),
+					 MPI_BYTE, pairing->initiators[pair], 0,
+					 MPI_COMM_WORLD, &status);
+				stream_eval_merge(pooled_stream, stream_eval);
+			}
+		} else if (pairing->initiator) {
+			MPI_Send(stream_eval, sizeof(stream_eval_t), MPI_BYTE,
+				 0, 0, MPI_COMM_WORLD);
+		}
+	} else {
+		/* pool the samples of all pairs on rank 0 */
+		if (my_rank == 0) {
+			pooled_stamps = (double *)calloc(
+			    sizeof(double),
+			    (size_t)numrounds * pairing->num_pairs);
+			pooled_counts = (int *)calloc(sizeof(int), num_ranks);
+			pooled_displs = (int *)calloc(sizeof(int), num_ranks);
+			for (pair = 0; pair < pairing->num_pairs; ++pair) {
+				pooled_counts[pairing->initiators[pair]] =
+				    numrounds;
+				pooled_displs[pairing->initiators[pair]] =
+				    pair * numrounds;
+			}
+		}
+		MPI_Gatherv(time_stamps, pairing->initiator ? numrounds : 0,
+			    MPI_DOUBLE, pooled_stamps, pooled_counts,
+			    pooled_displs, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+		if (pairing->initiator)
+			statistical_eval(time_stamps, numrounds, stat_eval);
+	}
+
+	if (pairing->initiator) {
+		summary[0] = stat_eval->minimum;
+		summary[1] = stat_eval->box_plot.median;
+		summary[2] = stat_eval->tail.num_percentiles
+		    ? stat_eval->tail
+			  .percentile_vals[stat_eval->tail.num_percentiles - 1]
+		    : stat_eval->maximum;
+		summary[3] = stat_eval->maximum;
+		summary[4] = stat_eval->average;
+		summary[5] = stat_eval->tail.steady_maximum;
+	}
+	MPI_Gather(summary, SUMMARYVALS, MPI_DOUBLE, summaries, SUMMARYVALS,
+		   MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+	if (my_rank == 0) {
+		if (run_infinitely == true) {
+			stream_eval_finalize(pooled_stream, stat_eval);
+			*count = pooled_stream->count;
+		} else {
+			*count = (uint64_t)numrounds * pairing->num_pairs;
+			if (raw && report_dump_samples(raw, info, pooled_stamps,
+						       *count,
+						       pairing->num_pairs))
+				fprintf(stderr, "WARNING: cannot write the raw "
+					"samples\n");
+			statistical_eval(pooled_stamps, *count, stat_eval);
+
+			/* the warm-up is excluded per pair */
+			stat_eval->tail.steady_maximum = -INFINITY;
+			for (pair = 0; pair < pairing->num_pairs; ++pair) {
+				int32_t initiator = pairing->initiators[pair];
+				double steady_max =
+				    summaries[initiator * SUMMARYVALS + 5];
+
+				if (steady_max > stat_eval->tail.steady_maximum)
+					stat_eval->tail.steady_maximum =
+					    steady_max;
+			}
+		}
+	}
+
+	free(pooled_stamps);
+	free(pooled_counts);
+	free(pooled_displs);
+	free(pooled_stream);
+}
+
+/* ranks grouped by node, in ascending order within a node */
+static void matrix_order(const pairing_t *pairing, int32_t *order) {
+	int32_t i, j, tmp;
+
+	for (i = 0; i < pairing->num_ranks; ++i) order[i] = i;
+	for (i = 1; i < pairing->num_ranks; ++i) {
+		tmp = order[i];
+		for (j = i; (j > 0) && (pairing->nodes[order[j - 1]] >
+					pairing->nodes[tmp]);
+		     --j)
+			order[j] = order[j - 1];
+		order[j] = tmp;
+	}
+}
+
+/*
+ * Flag links whose latency is far above the typical link of the same kind
+ * (intra- or inter-node): the robust z-score uses the median and the median
+ * absolute deviation, so a few bad links cannot hide themselves. Returns
+ * the score of every link (0 on the diagonal).
+ */
+static void matrix_outliers(const pairing_t *pairing, const double *lat,
+			    double *score) {
+	int32_t n = pairing->num_ranks;
+	int32_t i, j, num, inter;
+	double *vals = (double *)malloc(sizeof(double) * n * n);
+	double median, mad;
+
+	for (i = 0; i < n * n; ++i) score[i] = 0;
+	for (inter = 0; inter < 2; ++inter) {
+		num = 0;
+		for (i = 0; i < n; ++i) {
+			for (j = i + 1; j < n; ++j) {
+				if ((pairing->nodes[i] != pairing->nodes[j]) ==
+				    inter)
+					vals[num++] = lat[i * n + j];
+			}
+		}
+		if (num < 3) continue;
+		median = stat_eval_median(vals, num);
+		for (i = 0; i < num; ++i) vals[i] = fabs(vals[i] - median);
+		mad = 1.4826 * stat_eval_median(vals, num);
+
+		/* identical links would flag any jitter */
+		if (mad < 0.01 * median) mad = 0.01 * median;
+		for (i = 0; i < n; ++i) {
+			for (j = i + 1; j < n; ++j) {
+				if ((pairing->nodes[i] != pairing->nodes[j]) !=
+				    inter)
+					continue;
+				score[i * n + j] = score[j * n + i] =
+				    (lat[i * n + j] - median) / mad;
+			}
+		}
+	}
+	free(vals);
+}
+
+/* N x N latency (usec) or bandwidth (MB/s) matrix, outliers marked '*' */
+static void print_matrix(const pairing_t *pairing, const int32_t *order,
+			 const double *lat, const double *score,
+			 uint32_t length, bool bandwidth, FILE *output) {
+	int32_t n = pairing->num_ranks;
+	int32_t i, j, row, col;
+	double val;
+
+	fprintf(output, "##----------------------------------------------\n");
+	fprintf(output, "#%s matrix (%s), ranks grouped by node\n",
+		bandwidth ? "Bandwidth" : "Latency",
+		bandwidth ? "MB/s" : "usec");
+	fprintf(output, "#%5s %5s ", "node", "rank");
+	for (j = 0; j < n; ++j) {
+		if (j && (pairing->nodes[order[j]] !=
+			  pairing->nodes[order[j - 1]]))
+			fprintf(output, " |");
+		fprintf(output, " %9d", order[j]);
+	}
+	fprintf(output, "\n");
+	for (i = 0; i < n; ++i) {
+		row = order[i];
+		fprintf(output, "%6d %5d ", pairing->nodes[row], row);
+		for (j = 0; j < n; ++j) {
+			col = order[j];
+			if (j && (pairing->nodes[col] !=
+				  pairing->nodes[order[j - 1]]))
+				fprintf(output, " |");
+			if (row == col) {
+				fprintf(output, " %9s", "-");
+				continue;
+			}
+			val = lat[row * n + col];
+			if (bandwidth)
+				val = (length / (val * 1e-6)) / (1024 * 1024);
+			fprintf(output, " %8.2f%c", val,
+				(score[row * n + col] > OUTLIERZ) ? '*' : ' ');
+		}
+		fprintf(output, "\n");
+	}
+}
+
+/*
+ * All-pairs mode: every pair of ranks ping-pongs once in the rounds of a
+ * round-robin tournament, i.e., each rank talks to one partner at a time.
+ * Rank 0 collects the median latency of every link.
+ */
+static void run_matrix(pairing_t *pairing, cache_mode_t cache_mode,
+		       size_t pool_size, uint32_t length, uint32_t iterations,
+		       int32_t numrounds, double *time_stamps, FILE *output) {
+	int32_t n = pairing->num_ranks;
+	int32_t my_rank, round, i, j, partner;
+	int64_t rounds;
+	double median = 0;
+	double *medians = NULL, *lat = NULL, *score = NULL;
+	int32_t *order = NULL;
+	cache_t cache;
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+	if (my_rank == 0) {
+		medians = (double *)malloc(sizeof(double) * n);
+		lat = (double *)calloc(sizeof(double), n * n);
+	}
+
+	for (round = 0; round < pairing_num_rounds(n); ++round) {
+		pairing_tournament(MPI_COMM_WORLD, round, pairing);
+		if (cache_setup(&cache, cache_mode, send_buffer, recv_buffer,
+				length, pool_size, &send_mem)) {
+			setup_fail("cannot set up cache mode '%s'",
+				   cache_name(cache_mode));
+		}
+
+		MPI_Barrier(MPI_COMM_WORLD);
+		if (adaptive) adaptive_start(adaptive);
+		if (pairing->initiator)
+			rounds = initiator_rounds(&cache, pairing->partner,
+						  length, iterations, numrounds,
+						  false, time_stamps, NULL);
+		else if (pairing->partner != -1)
+			rounds = responder_rounds(&cache, pairing->partner,
+						  length, iterations, numrounds,
+						  false);
+		else
+			rounds = idle_rounds(numrounds, false);
+		cache_free(&cache);
+
+		median = pairing->initiator
+		    ? stat_eval_median(time_stamps, rounds)
+		    : 0;
+		MPI_Gather(&median, 1, MPI_DOUBLE, medians, 1, MPI_DOUBLE, 0,
+			   MPI_COMM_WORLD);
+		if (my_rank == 0) {
+			for (i = 0; i < pairing->num_pairs; ++i) {
+				j = pairing->initiators[i];
+				partner = pairing->partners[j];
+				lat[j * n + partner] = medians[j];
+				lat[partner * n + j] = medians[j];
+			}
+		}
+	}
+
+	if (my_rank == 0) {
+		order = (int32_t *)malloc(sizeof(int32_t) * n);
+		score = (double *)malloc(sizeof(double) * n * n);
+		matrix_order(pairing, order);
+		matrix_outliers(pairing, lat, score);
+		print_matrix(pairing, order, lat, score, length, false, output);
+		print_matrix(pairing, order, lat, score, length, true, output);
+
+		fprintf(output,
+			"##----------------------------------------------\n");
+		fprintf(output, "#Outlier links (robust z-score > %.1f among "
+				"intra-/inter-node links)\n", OUTLIERZ);
+		fprintf(output, "#Ranks        Nodes          Latency    "
+				"z-score\n");
+		for (i = 0; i < n; ++i) {
+			for (j = i + 1; j < n; ++j) {
+				if (score[i * n + j] <= OUTLIERZ) continue;
+				fprintf(output,
+					"#%5d-%-5d  %5d-%-5d %10.2f %10.2f\n",
+					i, j, pairing->nodes[i],
+					pairing->nodes[j], lat[i * n + j],
+					score[i * n + j]);
+			}
+		}
+	}
+
+	free(medians);
+	free(lat);
+	free(score);
+	free(order);
+}
+
+/* parse load levels in MB/s per loader; 'max' is unthrottled */
+static uint32_t parse_load_levels(char *list, double *levels) {
+	uint32_t num_levels = 0;
+	char *level;
+
+	for (level = strtok(list, ","); level && (num_levels < MAXLOADLEVELS);
+	     level = strtok(NULL, ","))
+		levels[num_levels++] =
+		    (strcmp(level, "max") == 0) ? INFINITY : atof(level);
+
+	return num_levels;
+}
+
+static void load_level_name(double level, char *name, size_t size) {
+	if (isinf(level))
+		snprintf(name, size, "max");
+	else
+		snprintf(name, size, "%g", level);
+}
+
+/* latency distribution per load level, relative to the first idle level */
+static void print_load_comparison(const double *levels, uint32_t num_levels,
+				  const stat_eval_t *evals,
+				  const double *achieved, FILE *output) {
+	const stat_eval_t *idle = NULL;
+	char name[32];
+	uint32_t level, i;
+
+	for (level = 0; level < num_levels; ++level) {
+		if (levels[level] == 0) {
+			idle = &evals[level];
+			break;
+		}
+	}
+
+	fprintf(output, "##----------------------------------------------\n");
+	fprintf(output, "#%-9s %10s %10s", "Load MB/s", "achieved", "Median");
+	for (i = 0; i < evals[0].tail.num_percentiles; ++i) {
+		snprintf(name, sizeof(name), "p%g",
+			 evals[0].tail.percentiles[i]);
+		fprintf(output, " %10s", name);
+	}
+	fprintf(output, " %10s %10s %10s\n", "Maximum", "vs. idle",
+		"tail/idle");
+	for (level = 0; level < num_levels; ++level) {
+		const stat_eval_t *eval = &evals[level];
+
+		load_level_name(levels[level], name, sizeof(name));
+		fprintf(output, "#%-9s %10.1f %10.2f", name, achieved[level],
+			eval->box_plot.median);
+		for (i = 0; i < eval->tail.num_percentiles; ++i)
+			fprintf(output, " %10.2f",
+				eval->tail.percentile_vals[i]);
+		fprintf(output, " %10.2f", eval->maximum);
+		if (idle && eval->tail.num_percentiles)
+			fprintf(output, " %10.2f %10.2f\n",
+				eval->box_plot.median / idle->box_plot.median,
+				eval->tail.percentile_vals
+					[eval->tail.num_percentiles - 1] /
+				    idle->tail.percentile_vals
+					[idle->tail.num_percentiles - 1]);
+		else if (idle)
+			fprintf(output, " %10.2f %10s\n",
+				eval->box_plot.median / idle->box_plot.median,
+				"-");
+		else
+			fprintf(output, " %10s %10s\n", "-", "-");
+	}
+}
+
+/* warm and cold (or rotating) latency of the pooled samples side by side */
+static void print_cache_comparison(const double *cache_summaries,
+				   int first_cache, int last_cache,
+				   FILE *output) {
+	int mode;
+	const double *vals;
+
+	fprintf(output, "##----------------------------------------------\n");
+	fprintf(output, "#Cache         Minimum     Median       Tail    "
+			"Maximum    Average   vs. warm\n");
+	for (mode = first_cache; mode <= last_cache; ++mode) {
+		vals = &cache_summaries[mode * SUMMARYVALS];
+		fprintf(output, "#%-10s %10.2f %10.2f %10.2f %10.2f %10.2f",
+			cache_name(mode), vals[0], vals[1], vals[2], vals[3],
+			vals[4]);
+		if (first_cache == CACHE_WARM)
+			fprintf(output, " %10.2f\n",
+				vals[1] / cache_summaries[1]);
+		else
+			fprintf(output, " %10s\n", "-");
+	}
+}
+
 int main(int argc, char **argv) {
 	int arg;
-	uint32_t i;
 	int32_t num_ranks;
 	int32_t remote_rank, my_rank;
 
 	uint32_t length = DEFAULTLEN;
 	uint32_t iterations = DEFAULTITER;
-	int32_t numrounds = DEFAULTROUNDS;
-	int32_t round;
+	int32_t numrounds = 0;
+	int32_t rounds = 0;
 
-	double timer;
 	double *time_stamps = NULL;
 	stat_eval_t stat_eval;
+	stream_eval_t *stream_eval = NULL;
+	uint64_t count = 0;
 	bool run_infinitely;
-	MPI_Status status;
-	char *filename = NULL;
+	pairing_mode_t pairing_mode = PAIRING_NEIGHBORS;
+	pairing_t pairing;
+	uint32_t seed = 0;
+	setup_t setup;
+	cache_mode_t cache_mode;
+	cache_mode_t first_cache = CACHE_WARM, last_cache = CACHE_WARM;
+	size_t pool_size = 0;
+	cache_t cache;
+	double *summaries = NULL;
+	double cache_summaries[CACHE_NUM_MODES * SUMMARYVALS];
+	FILE *output = stdout;
+	report_format_t format = REPORT_TEXT;
+	report_info_t info;
+	report_t report;
+	char *rawname = NULL;
+	FILE *raw = NULL;
+	ringlog_mode_t log_mode = RINGLOG_BATCH;
+	bool log_rounds = false, log_cost = false;
+	ringlog_t log;
+	double adaptive_target = 0, adaptive_budget = 0;
+	uint32_t adaptive_batch = 0;
+	adaptive_t adapt;
+	bool matrix = false;
+	bool load = false;
+	congestion_mode_t load_mode = CONGESTION_ALLTOALL;
+	congestion_t congestion;
+	char *load_list = DEFAULTLOADLEVELS;
+	double load_levels[MAXLOADLEVELS];
+	uint32_t num_levels = 0;
+	uint32_t load_length = CONGESTION_DEFAULT_LENGTH;
+	stat_eval_t level_evals[MAXLOADLEVELS];
+	double achieved[MAXLOADLEVELS];
+	double rate = 0;
+	char variant[64];
+	int32_t run, num_runs;
 
-	/* determine arguments */
-	while ((arg = getopt(argc, argv, "i:r:l:hf:")) != -1) {
+	/* determine arguments; before MPI_Init(), every rank reports errors */
+	setup_init(&setup, 0);
+	while ((arg = getopt(argc, argv,
+			     "i:r:l:hf:p:w:P:s:C:K:F:D:I:Ta:b:n:MG:g:z:"
+			     SETUP_OPTIONS)) != -1) {
 		switch (arg) {
 			case 'r':
 				numrounds = atoi(optarg);
 				break;
-			case 'f':
-				filename = optarg;
-				break;
 			case 'l':
 				length = atoi(optarg);
 				break;
 			case 'i':
 				iterations = atoi(optarg);
 				break;
+			case 'p':
+				if (stat_eval_set_percentiles(optarg)) {
+					setup_abort(setup.my_rank,
+						    "invalid percentile list "
+						    "'%s'", optarg);
+				}
+				break;
+			case 'w':
+				stat_eval_set_warmup(atoi(optarg));
+				break;
+			case 'P':
+				if (pairing_parse(optarg, &pairing_mode)) {
+					setup_abort(setup.my_rank,
+						    "unknown pairing '%s'",
+						    optarg);
+				}
+				break;
+			case 's':
+				seed = atoi(optarg);
+				break;
+			case 'C':
+				if (strcmp(optarg, "all") == 0) {
+					first_cache = CACHE_WARM;
+					last_cache = CACHE_NUM_MODES - 1;
+					break;
+				}
+				if (cache_parse(optarg, &first_cache)) {
+					setup_abort(setup.my_rank,
+						    "unknown cache mode '%s'",
+						    optarg);
+				}
+				last_cache = first_cache;
+				break;
+			case 'K':
+				pool_size = strtoull(optarg, NULL, 0);
+				break;
+			case 'F':
+				if (report_parse(optarg, &format)) {
+					setup_abort(setup.my_rank,
+						    "unknown format '%s'",
+						    optarg);
+				}
+				break;
+			case 'D':
+				rawname = optarg;
+				break;
+			case 'I':
+				if (ringlog_parse(optarg, &log_mode)) {
+					setup_abort(setup.my_rank,
+						    "unknown logging mode '%s'",
+						    optarg);
+				}
+				log_rounds = true;
+				break;
+			case 'T':
+				log_cost = true;
+				break;
+			case 'a':
+				adaptive_target = atof(optarg);
+				break;
+			case 'b':
+				adaptive_budget = atof(optarg);
+				break;
+			case 'n':
+				adaptive_batch = atoi(optarg);
+				break;
+			case 'M':
+				matrix = true;
+				break;
+			case 'G':
+				if (congestion_parse(optarg, &load_mode)) {
+					setup_abort(setup.my_rank,
+						    "unknown load '%s'",
+						    optarg);
+				}
+				load = true;
+				break;
+			case 'g':
+				load_list = optarg;
+				break;
+			case 'z':
+				load_length = atoi(optarg);
+				break;
 			case 'h':
 				printf(
 				    "usage %s [-l message_length (def: %d)] "
 				    "[-i iterations (def: %d)] "
 				    "[-r rounds (def: %d)] "
-				    "[-f filename]\n",
+				    "[-p percentiles (def: 99,99.9,99.99)] "
+				    "[-w rounds excluded from steady max] "
+				    "[-P pairing (def: %s)] "
+				    "[-s seed for random pairing] "
+				    "[-C warm|cold|rotate|all (def: warm)] "
+				    "[-K rotating pool bytes (def: 2x LLC)] "
+				    "[-F text|csv|json (def: text)] "
+				    "[-D raw sample file] "
+				    "[-I direct|batch|thread (print rounds)] "
+				    "[-T (report the cost of -I)] "
+				    "[-a target CI width in %% of the median] "
+				    "[-b time budget per measurement in s] "
+				    "[-n rounds between CI checks (def: %d)] "
+				    "[-M (all-pairs latency/bandwidth matrix)] "
+				    "[-G alltoall|incast|stream (background "
+				    "load by the other ranks)] "
+				    "[-g load levels in MB/s per loader "
+				    "(def: %s)] "
+				    "[-z load message length (def: %d)] ",
 				    argv[0], DEFAULTLEN, DEFAULTITER,
-				    DEFAULTROUNDS);
+				    DEFAULTROUNDS, DEFAULTPAIRING,
+				    ADAPTIVE_DEFAULT_BATCH, DEFAULTLOADLEVELS,
+				    CONGESTION_DEFAULT_LENGTH);
+				setup_usage(stdout, true);
+				printf("\nrounds = -1 runs until "
+				       "SIGINT/SIGTERM/SIGUSR1\n"
+				       "with -a, rounds is the maximum "
+				       "(def: %d)\n"
+				       "pairings: neighbors half random "
+				       "intra inter\n",
+				       ADAPTIVEMAXROUNDS);
 				exit(0);
+			default:
+				setup_parse(&setup, arg, optarg);
+				break;
 		}
 	}
 
+	/* adaptive runs stop at the latest after the given rounds */
+	if (numrounds == 0)
+		numrounds = (adaptive_target > 0) ? ADAPTIVEMAXROUNDS
+						  : DEFAULTROUNDS;
+
 	/* initialize MPI environment */
 	MPI_Init(&argc, &argv);
 	MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+	setup.my_rank = my_rank;
 	MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
 
 	/* check for errors and determine remote rank */
-	if (num_ranks != 2) {
+	if (num_ranks < 2) {
 		if (my_rank == 0)
 			fprintf(stderr,
-				"Pingpong needs exactly two UEs; try again\n");
+				"Pingpong needs at least two UEs; try again\n");
+		exit(-1);
+	}
+	pairing_setup(MPI_COMM_WORLD, pairing_mode, seed, &pairing);
+	if (pairing.num_pairs == 0) {
+		if (my_rank == 0)
+			fprintf(stderr, "No pairs for pairing '%s'; try "
+				"again\n", pairing_name(pairing_mode));
 		exit(-1);
 	}
-	remote_rank = (my_rank + 1) % 2;
 
-/* perform a warm-up of the cache */
-#ifdef _CACHE_WARM_UP_
-	for (i = 0; i < length; i++) {
-		/* cache warm-up: */
-		dummy += send_buffer[i];
-		dummy += recv_buffer[i];
+	/* the first pair is measured, all other ranks generate load */
+	if (load) {
+		load_list = strdup(load_list);
+		num_levels = parse_load_levels(load_list, load_levels);
+		free(load_list);
+		if ((num_ranks < 3) || (num_levels == 0)) {
+			setup_abort(my_rank, "background load needs at least "
+				    "3 ranks and one load level");
+		}
+		pairing_limit(MPI_COMM_WORLD, 1, &pairing);
+		if (congestion_setup(&congestion, load_mode, MPI_COMM_WORLD,
+				     pairing.initiators[0],
+				     pairing.partners[pairing.initiators[0]],
+				     load_length)) {
+			setup_fail("cannot set up the load");
+		}
 	}
+	remote_rank = pairing.partner;
+
+	/* select and calibrate the time source */
+	setup_timer(&setup);
+
+	/* allocate the message buffers */
+	setup_buffer(&setup, &send_mem, length);
+	send_buffer = send_mem.ptr;
+#ifdef _USE_SEPARATED_BUFFERS_
+	setup_buffer(&setup, &recv_mem, length);
+	recv_buffer = recv_mem.ptr;
+#else
+	recv_buffer = send_buffer;
 #endif
 
+	/* per-round output of the initiators */
+	if (log_rounds && pairing.initiator) {
+		if (ringlog_init(&log, log_mode, RINGLOG_DEFAULT_CAPACITY,
+				 stdout, "%.0f\t\t%1.2lf\t\t%1.2lf\n",
+				 log_cost)) {
+			setup_fail("cannot set up the round output");
+		}
+		round_log = &log;
+	}
+
+	/* metadata of the machine-readable output */
+	report_info_collect(MPI_COMM_WORLD, &info);
+	info.benchmark = "pingpong_lat";
+	info.length = length;
+	info.rounds = numrounds;
+	info.iterations = iterations;
+	info.num_pairs = pairing.num_pairs;
+
 	/* check for infinite test */
 	if (numrounds == -1) {
+		if (first_cache != last_cache) {
+			setup_abort(my_rank, "infinite runs need a single "
+				    "cache mode");
+		}
+		if (rawname) {
+			setup_abort(my_rank, "infinite runs keep no raw "
+				    "samples");
+		}
+		if (adaptive_target > 0) {
+			setup_abort(my_rank,
+				    "infinite runs cannot be adaptive");
+		}
 		run_infinitely = true;
+		stream_eval = (stream_eval_t *)malloc(sizeof(stream_eval_t));
+		signal(SIGINT, stop_handler);
+		signal(SIGTERM, stop_handler);
+		signal(SIGUSR1, stop_handler);
 	} else {
 		run_infinitely = false;
 		time_stamps = (double *)calloc(sizeof(double), numrounds);
 	}
+	if (load && (run_infinitely || (first_cache != last_cache) ||
+		     (adaptive_target > 0) || matrix)) {
+		setup_abort(my_rank, "background load needs finite, "
+			    "non-adaptive rounds and a single cache mode");
+	}
+	if (matrix && (run_infinitely || (first_cache != last_cache) ||
+		       rawname || log_rounds || (format != REPORT_TEXT))) {
+		setup_abort(my_rank, "the matrix mode needs finite rounds, a "
+			    "single cache mode and text output without -D/-I");
+	}
+	if (adaptive_target > 0) {
+		adaptive_init(&adapt, adaptive_target, adaptive_budget,
+			      adaptive_batch);
+		adaptive = &adapt;
+	}
 
-	if (my_rank == 0) {
+	/* the banner would corrupt machine-readable output on stdout */
+	if ((my_rank == 0) && ((format == REPORT_TEXT) || setup.filename)) {
 		printf("Starting the benchmark:\n");
 		if (numrounds == -1) {
 			printf("Rounds     :        inf\n");
 		} else {
-			printf("Rounds     : %10d\n", numrounds);
+			printf("Rounds     : %10d%s\n", numrounds,
+			       adaptive ? " (max.)" : "");
+		}
+		if (adaptive) {
+			printf("Adaptive   : %9.2f%% (%d%% CI of the median, "
+			       "batch %u", adapt.target, ADAPTIVE_CONFIDENCE,
+			       adapt.batch);
+			if (adapt.budget > 0)
+				printf(", budget %g s", adapt.budget);
+			printf(")\n");
 		}
 		printf("Iterations : %10d\n", iterations);
 		printf("Msg Length : %10d\n", length);
-		if (filename) {
-			printf("Filename   : %s\n", filename);
+		if (matrix) {
+			printf("Pairing    : %10s (%d rounds)\n", "all",
+			       pairing_num_rounds(num_ranks));
+			printf("Pairs      : %10d\n",
+			       num_ranks * (num_ranks - 1) / 2);
 		} else {
-			printf("Filename   :     stdout\n");
+			printf("Pairing    : %10s\n",
+			       pairing_name(pairing_mode));
+			printf("Pairs      : %10d\n", pairing.num_pairs);
 		}
+		if (load) {
+			printf("Load       : %10s (%d loaders, %u bytes, "
+			       "MB/s:", congestion_name(load_mode),
+			       congestion.num_loaders, load_length);
+			for (run = 0; run < (int32_t)num_levels; ++run) {
+				load_level_name(load_levels[run], variant,
+						sizeof(variant));
+				printf(" %s", variant);
+			}
+			printf(")\n");
+		}
+		printf("Cache      : %10s",
+		       (first_cache == last_cache) ? cache_name(first_cache)
+						   : "all");
+		if (last_cache == CACHE_ROTATE)
+			printf(" (pool %zu bytes)",
+			       pool_size ? pool_size : 2 * cache_llc_size());
+		printf("\n");
+		setup_print(&setup, false);
 	}
 
-	/* synchronize and start the PingPong */
-	MPI_Barrier(MPI_COMM_WORLD);
 	if (my_rank == 0) {
-		for (i = 0; i < WARMUPITER; ++i) {
-			MPI_Send(send_buffer, length, MPI_CHAR, remote_rank, 0,
-				 MPI_COMM_WORLD);
-			MPI_Recv(recv_buffer, length, MPI_CHAR, remote_rank, 0,
-				 MPI_COMM_WORLD, &status);
+		summaries = (double *)calloc(sizeof(double),
+					     num_ranks * SUMMARYVALS);
+		output = setup_output(&setup);
+		if (rawname && !(raw = fopen(rawname, "wb"))) {
+			setup_fail("cannot open '%s'", rawname);
 		}
-		MPI_Barrier(MPI_COMM_WORLD);
+		report_begin(&report, format, output);
+	}
 
-		for (round = 0; run_infinitely || (round < numrounds);
-		     ++round) {
-			/* start timer: */
-			timer = MPI_Wtime();
-
-			for (i = 0; i < iterations; ++i) {
-				MPI_Send(send_buffer, length, MPI_CHAR,
-					 remote_rank, 0, MPI_COMM_WORLD);
-				MPI_Recv(recv_buffer, length, MPI_CHAR,
-					 remote_rank, 0, MPI_COMM_WORLD,
-					 &status);
-			}
+	if (matrix)
+		run_matrix(&pairing, first_cache, pool_size, length,
+			   iterations, numrounds, time_stamps, output);
 
-			/* stop timer: */
-			timer = (MPI_Wtime() - timer);
-			if (run_infinitely == false)
-				time_stamps[round] =
-				    timer * 1e6 / (2 * iterations);
-#ifdef _PRINT_INDIVIDUAL_RES_
-			printf("%d\t\t%1.2lf\t\t%1.2lf\n", length,
-			       timer / (2.0 * iterations) * 1000000,
-			       (length / (timer / (2.0 * iterations))) /
-				   (1024 * 1024));
-			fflush(stdout);
+	/* one run per cache mode or per load level */
+	num_runs = load ? (int32_t)num_levels
+			: (int32_t)(last_cache - first_cache) + 1;
+	for (run = 0; !matrix && (run < num_runs); ++run) {
+		cache_mode = load ? first_cache : first_cache + run;
+		if (cache_setup(&cache, cache_mode, send_buffer, recv_buffer,
+				length, pool_size, &send_mem)) {
+			setup_fail("cannot set up cache mode '%s'",
+				   cache_name(cache_mode));
+		}
+		if (run_infinitely) stream_eval_init(stream_eval);
 
-#endif
-#ifdef _WATCH_DOG_
-			if (!(round % 100000)) printf("Round %d ...\n", round);
-#endif
+		/* synchronize and start the PingPong */
+		MPI_Barrier(MPI_COMM_WORLD);
+		if (adaptive) adaptive_start(adaptive);
+		if (pairing.initiator) {
+			rounds = initiator_rounds(&cache, remote_rank, length,
+						  iterations, numrounds,
+						  run_infinitely, time_stamps,
+						  stream_eval);
+			if (load) congestion_stop(&congestion);
+		} else if (pairing.partner != -1) {
+			rounds = responder_rounds(&cache, remote_rank, length,
+						  iterations, numrounds,
+						  run_infinitely);
+		} else if (load) {
+			/* the load lasts as long as the measurement */
+			MPI_Barrier(MPI_COMM_WORLD);
+			rate = congestion_run(&congestion,
+					      load_levels[run] * 1024 * 1024);
+			rounds = numrounds;
+		} else {
+			rounds = idle_rounds(numrounds, run_infinitely);
 		}
-	} else {
-		for (i = 0; i < WARMUPITER; ++i) {
-			MPI_Recv(recv_buffer, length, MPI_CHAR, remote_rank, 0,
-				 MPI_COMM_WORLD, &status);
-			MPI_Send(send_buffer, length, MPI_CHAR, remote_rank, 0,
-				 MPI_COMM_WORLD);
+		cache_free(&cache);
+		if (round_log) ringlog_flush(round_log, true);
+
+		/* adaptive runs end after the same round on all ranks */
+		info.variant = cache_name(cache_mode);
+		if (load) {
+			snprintf(variant, sizeof(variant), "%s@",
+				 congestion_name(load_mode));
+			load_level_name(load_levels[run],
+					variant + strlen(variant),
+					sizeof(variant) - strlen(variant));
+			info.variant = variant;
+			MPI_Reduce(&rate, &achieved[run], 1, MPI_DOUBLE,
+				   MPI_SUM, 0, MPI_COMM_WORLD);
+			achieved[run] /= congestion.num_loaders * 1024.0 * 1024;
 		}
-		MPI_Barrier(MPI_COMM_WORLD);
+		info.rounds = run_infinitely ? -1 : rounds;
+		evaluate_rounds(&pairing, rounds, run_infinitely,
+				time_stamps, stream_eval, summaries, &stat_eval,
+				&count, &info, raw);
+
+		/* print the results */
+		if (my_rank == 0) {
+			double *vals =
+			    &cache_summaries[cache_mode * SUMMARYVALS];
 
-		for (round = 0; run_infinitely || (round < numrounds);
-		     ++round) {
-			for (i = 0; i < iterations; ++i) {
-				MPI_Recv(recv_buffer, length, MPI_CHAR,
-					 remote_rank, 0, MPI_COMM_WORLD,
-					 &status);
-				MPI_Send(send_buffer, length, MPI_CHAR,
-					 remote_rank, 0, MPI_COMM_WORLD);
+			if (format != REPORT_TEXT) {
+				report_record(&report, &info, &stat_eval,
+					      count);
+			} else {
+				if (first_cache != last_cache)
+					fprintf(output, "#cache: %s\n",
+						cache_name(cache_mode));
+				if (load)
+					fprintf(output, "#load: %s MB/s\n",
+						variant);
+				print_statistics(&stat_eval, count, output);
+				if (adaptive)
+					adaptive_print(adaptive, rounds,
+						       output);
+				print_pair_breakdown(&pairing, summaries,
+						     length, output);
 			}
+
+			vals[0] = stat_eval.minimum;
+			vals[1] = stat_eval.box_plot.median;
+			vals[2] = stat_eval.tail.num_percentiles
+			    ? stat_eval.tail.percentile_vals
+				  [stat_eval.tail.num_percentiles - 1]
+			    : stat_eval.maximum;
+			vals[3] = stat_eval.maximum;
+			vals[4] = stat_eval.average;
+			if (load) level_evals[run] = stat_eval;
 		}
 	}
 
-	/* Statistical evaluation */
-	if ((my_rank == 0) && (run_infinitely == false)) {
-		statistical_eval(time_stamps, numrounds, &stat_eval);
-
-		/* print the results */
-		FILE *output = stdout;
-		if (filename) {
-			output = fopen(filename, "w+");
-		}
-		print_statistics(&stat_eval, numrounds, output);
-		if (filename) {
-			fclose(output);
+	if (my_rank == 0) {
+		if ((format == REPORT_TEXT) && (first_cache != last_cache))
+			print_cache_comparison(cache_summaries, first_cache,
+					       last_cache, output);
+		if ((format == REPORT_TEXT) && load)
+			print_load_comparison(load_levels, num_levels,
+					      level_evals, achieved, output);
+		report_end(&report);
+		setup_close(&setup);
+		if (raw) {
+			fclose(raw);
 		}
 	}
 
+	if (round_log) {
+		ringlog_finish(round_log);
+		if (log_cost) ringlog_report(round_log, stdout);
+	}
+
+	free(time_stamps);
+	free(stream_eval);
+	free(summaries);
+	report_info_free(&info);
+	if (load) congestion_free(&congestion);
+	pairing_free(&pairing);
+	buffer_free(&send_mem);
+#ifdef _USE_SEPARATED_BUFFERS_
+	buffer_free(&recv_mem);
+#endif
+
 	MPI_Finalize();
 
 	return 0;
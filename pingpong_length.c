@@ -16,6 +16,7 @@
  *
  */
 
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -23,189 +24,567 @@
 
 #include <mpi.h>
 
+#include <adaptive.h>
+#include <buffer.h>
+#include <pairing.h>
+#include <setup.h>
+#include <stat_eval.h>
+#include <timer.h>
+
 #define _CACHE_WARM_UP_
 #undef _USE_SEPARATED_BUFFERS_
 #undef _ERROR_CHECK_
 #undef _EXTENDED_ERROR_CHECK_
 
-#define MAXBUFSIZE (1024 * 1024 * 64)
 #define SEND_MASK 0xff
 #define RECV_MASK 0x00
-#define DEFAULTLEN MAXBUFSIZE
+#define DEFAULTLEN (1024 * 1024 * 64)
 #define NUMROUNDS 1000
 #define WARM_UP 100
+#define DEFAULTPAIRING "neighbors"
+#define DEFAULTWINDOW 64
+#define STREAMROUNDS 100
+#define ADAPTIVEMAXROUNDS 100000
 
-#ifdef _USE_SEPARATED_BUFFERS_
-unsigned char send_buffer[MAXBUFSIZE + 1];
-unsigned char recv_buffer[MAXBUFSIZE + 1];
-#else
-#define send_buffer buffer
-#define recv_buffer buffer
-unsigned char buffer[MAXBUFSIZE + 1];
-#endif
+/* transfer modes of the size sweep */
+#define MODE_PINGPONG 0	/* blocking MPI_Ssend/MPI_Recv round trip */
+#define MODE_STREAM 1	/* window of MPI_Isend/MPI_Irecv, one ack */
+#define MODE_BIDIR 2	/* both sides stream a window at once */
+#define NUMMODES 3
+
+static const char *mode_names[NUMMODES] = {"pingpong", "stream", "bidir"};
+
+/*
+ * message buffers (recv_buffer aliases send_buffer unless separated); the
+ * windowed modes receive while their sends are pending and always use a
+ * buffer of their own
+ */
+buffer_t send_mem, recv_mem;
+unsigned char *send_buffer = NULL;
+unsigned char *recv_buffer = NULL;
+unsigned char *window_buffer = NULL;
 unsigned char dummy = 0;
 
+/* stop criterion of adaptive runs, if requested */
+adaptive_t *adaptive = NULL;
+
+/* per-size report state on rank 0 (buffers are reused for all sizes) */
+typedef struct _size_report_t {
+	double *pooled;		/* samples of all pairs */
+	int *counts;		/* samples per rank for MPI_Gatherv */
+	int *displs;
+	double *first_lat;	/* per pair: latency of the smallest size */
+	double *last_bw;	/* per pair: bandwidth of the largest size */
+} size_report_t;
+
+/*
+ * Collect the samples (usec per message) of all pairs on rank 0 and print
+ * one row: mean latency/bandwidth (averaged over the pairs, plus aggregate
+ * and spread for several pairs) and the statistics of the pooled samples.
+ * Adaptive runs append the number of rounds and the CI width.
+ */
+static void report_size(const pairing_t *pairing, size_report_t *report,
+			double *samples, int length, int numrounds,
+			double bytes_per_msg) {
+	int pair, round, my_rank;
+	double latency, bandwidth;
+	double lat_sum = 0, bw_sum = 0, bw_min = 0, bw_max = 0;
+	stat_eval_t stat_eval;
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+	if (my_rank == 0) {
+		for (pair = 0; pair < pairing->num_pairs; ++pair) {
+			report->counts[pairing->initiators[pair]] = numrounds;
+			report->displs[pairing->initiators[pair]] =
+			    pair * numrounds;
+		}
+	}
+	MPI_Gatherv(samples, pairing->initiator ? numrounds : 0, MPI_DOUBLE,
+		    report->pooled, report->counts, report->displs, MPI_DOUBLE,
+		    0, MPI_COMM_WORLD);
+	if (my_rank != 0) return;
+
+	for (pair = 0; pair < pairing->num_pairs; ++pair) {
+		latency = 0;
+		for (round = 0; round < numrounds; ++round)
+			latency += report->pooled[pair * numrounds + round];
+		latency /= numrounds;
+
+		bandwidth = (bytes_per_msg / (latency * 1e-6)) / (1024 * 1024);
+		lat_sum += latency;
+		bw_sum += bandwidth;
+		if ((pair == 0) || (bandwidth < bw_min)) bw_min = bandwidth;
+		if ((pair == 0) || (bandwidth > bw_max)) bw_max = bandwidth;
+
+		if (report->first_lat[pair] < 0)
+			report->first_lat[pair] = latency;
+		report->last_bw[pair] = bandwidth;
+	}
+
+	statistical_eval(report->pooled, numrounds * pairing->num_pairs,
+			 &stat_eval);
+
+	if (pairing->num_pairs == 1) {
+		printf("%d\t\t%1.2lf\t\t%1.2lf", length, lat_sum, bw_sum);
+	} else {
+		printf("%d\t\t%1.2lf\t\t%1.2lf\t\t%1.2lf\t\t%1.2lf\t\t"
+		       "%1.2lf",
+		       length, lat_sum / pairing->num_pairs,
+		       bw_sum / pairing->num_pairs, bw_sum, bw_min, bw_max);
+	}
+	printf("\t\t%1.2lf\t\t%1.2lf\t\t%1.2lf\t\t%1.2lf",
+	       stat_eval.box_plot.median, stat_eval.box_plot.lower_quartil,
+	       stat_eval.box_plot.upper_quartil,
+	       stat_eval.tail.num_percentiles
+		   ? stat_eval.tail
+			 .percentile_vals[stat_eval.tail.num_percentiles - 1]
+		   : stat_eval.maximum);
+	if (adaptive)
+		printf("\t\t%d\t\t%1.2lf", numrounds, adaptive->width);
+	printf("\n");
+	fflush(stdout);
+}
+
+/* one window of non-blocking transfers, acknowledged by the receiver */
+static void window_round(int mode, int length, int window, int remote_rank,
+			 int sender, MPI_Request *requests) {
+	int w;
+
+	if (mode == MODE_BIDIR) {
+		for (w = 0; w < window; ++w)
+			MPI_Irecv(window_buffer, length, MPI_CHAR, remote_rank,
+				  1, MPI_COMM_WORLD, &requests[w]);
+		for (w = 0; w < window; ++w)
+			MPI_Isend(send_buffer, length, MPI_CHAR, remote_rank, 1,
+				  MPI_COMM_WORLD, &requests[window + w]);
+		MPI_Waitall(2 * window, requests, MPI_STATUSES_IGNORE);
+		return;
+	}
+
+	if (sender) {
+		for (w = 0; w < window; ++w)
+			MPI_Isend(send_buffer, length, MPI_CHAR, remote_rank, 1,
+				  MPI_COMM_WORLD, &requests[w]);
+		MPI_Waitall(window, requests, MPI_STATUSES_IGNORE);
+		MPI_Recv(window_buffer, 0, MPI_CHAR, remote_rank, 2,
+			 MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+	} else {
+		for (w = 0; w < window; ++w)
+			MPI_Irecv(window_buffer, length, MPI_CHAR, remote_rank,
+				  1, MPI_COMM_WORLD, &requests[w]);
+		MPI_Waitall(window, requests, MPI_STATUSES_IGNORE);
+		MPI_Send(send_buffer, 0, MPI_CHAR, remote_rank, 2,
+			 MPI_COMM_WORLD);
+	}
+}
+
+/* one round of the given mode; the initiator sends first */
+static void size_round(int mode, int length, int window, int remote_rank,
+		       int initiator, MPI_Request *requests) {
+	MPI_Status status;
+
+	if (mode != MODE_PINGPONG) {
+		window_round(mode, length, window, remote_rank, initiator,
+			     requests);
+	} else if (initiator) {
+		/* send PING: */
+		MPI_Ssend(send_buffer, length, MPI_CHAR, remote_rank, 0,
+			  MPI_COMM_WORLD);
+
+		/* recv PONG: */
+		MPI_Recv(recv_buffer, length, MPI_CHAR, remote_rank, 0,
+			 MPI_COMM_WORLD, &status);
+	} else {
+		/* recv PING: */
+		MPI_Recv(recv_buffer, length, MPI_CHAR, remote_rank, 0,
+			 MPI_COMM_WORLD, &status);
+
+		/* send PONG: */
+		MPI_Ssend(send_buffer, length, MPI_CHAR, remote_rank, 0,
+			  MPI_COMM_WORLD);
+	}
+}
+
+#ifdef _ERROR_CHECK_
+/* the payload of a round, verified after the ping-pong */
+static void fill_round(int length, int round) {
+	int i;
+
+	for (i = 0; i < length; i++)
+		send_buffer[i] = (i + length + round) % 127;
+}
+
+static void check_round(int mode, int length, int round) {
+	int i;
+
+	for (i = 0; (mode == MODE_PINGPONG) && (i < length); i++) {
+		if (recv_buffer[i] != (i + length + round) % 127) {
+			fprintf(stderr, "ERROR: %d VS %d at %d\n",
+				recv_buffer[i], (i + length + round) % 127, i);
+			exit(-1);
+		}
+	}
+}
+#endif
+
+/*
+ * the rounds of one size after WARM_UP untimed ones; the initiator stores
+ * the usec per message; returns the number of samples
+ */
+static int measure_size(int mode, int length, int numrounds, int window,
+			int remote_rank, int initiator, MPI_Request *requests,
+			double *time_stamps) {
+	int round, samples;
+	int msgs_per_round = (mode == MODE_PINGPONG) ? 2 : window;
+	double timer = 0;
+#ifdef _CACHE_WARM_UP_
+	int i;
+
+	for (i = 0; i < length; i++) {
+		/* cache warm-up: */
+		dummy += send_buffer[i];
+		dummy += recv_buffer[i];
+	}
+#endif
+
+	/* synchronize before starting PING-PONG: */
+	MPI_Barrier(MPI_COMM_WORLD);
+	if (adaptive) adaptive_start(adaptive);
+
+	for (round = 0; round < numrounds + WARM_UP; round++) {
+#ifdef _ERROR_CHECK_
+		fill_round(length, round);
+#endif
+
+		/* start timer: */
+		if (initiator) timer = timer_now();
+
+		size_round(mode, length, window, remote_rank, initiator,
+			   requests);
+
+		/* stop timer: */
+		if (initiator && (round >= WARM_UP))
+			time_stamps[round - WARM_UP] =
+			    timer_elapsed(timer) * 1e6 / msgs_per_round;
+#ifdef _ERROR_CHECK_
+		check_round(mode, length, round);
+#endif
+
+		/* stop once the median has converged */
+		if (round < WARM_UP) continue;
+		samples = round + 1 - WARM_UP;
+		if (adaptive &&
+		    adaptive_check(adaptive, MPI_COMM_WORLD, samples,
+				   initiator ? time_stamps : NULL,
+				   initiator ? samples : 0))
+			return samples;
+	}
+
+	return numrounds;
+}
+
+/* unpaired ranks only take part in the synchronization */
+static int idle_size(int numrounds) {
+	int round;
+
+	MPI_Barrier(MPI_COMM_WORLD);
+	if (!adaptive) return numrounds;
+
+	adaptive_start(adaptive);
+	for (round = 1; round <= numrounds; ++round) {
+		if (adaptive_check(adaptive, MPI_COMM_WORLD, round, NULL, 0))
+			return round;
+	}
+
+	return numrounds;
+}
+
 int main(int argc, char **argv) {
 	int i;
 	int num_ranks;
 	int remote_rank, my_rank;
 	int numrounds = NUMROUNDS;
 	int maxlen = DEFAULTLEN;
-	int length;
-	int round;
-	double timer = 0;
-
-	MPI_Status status;
+	int length, last_length;
+	int size_rounds;
+	double bytes_per_msg;
+	double *time_stamps = NULL;
+	size_report_t report;
+	int arg;
+	pairing_mode_t pairing_mode = PAIRING_NEIGHBORS;
+	pairing_t pairing;
+	uint32_t seed = 0;
+	setup_t setup;
+	int mode, first_mode = MODE_PINGPONG, last_mode = MODE_PINGPONG;
+	int window = DEFAULTWINDOW;
+	int rounds = -1;
+	MPI_Request *requests = NULL;
+	double adaptive_target = 0, adaptive_budget = 0;
+	uint32_t adaptive_batch = 0;
+	adaptive_t adapt;
 
 	MPI_Init(&argc, &argv);
 
 	MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
 	MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+	setup_init(&setup, my_rank);
 
-	if (num_ranks != 2) {
+	/* determine arguments */
+	while ((arg = getopt(argc, argv,
+			     "P:s:m:W:r:p:L:a:b:n:h" SETUP_OPTIONS)) != -1) {
+		switch (arg) {
+			case 'P':
+				if (pairing_parse(optarg, &pairing_mode)) {
+					setup_abort(my_rank,
+						    "unknown pairing '%s'",
+						    optarg);
+				}
+				break;
+			case 's':
+				seed = atoi(optarg);
+				break;
+			case 'm':
+				if (strcmp(optarg, "all") == 0) {
+					first_mode = 0;
+					last_mode = NUMMODES - 1;
+					break;
+				}
+				for (mode = 0; mode < NUMMODES; ++mode) {
+					if (!strcmp(optarg, mode_names[mode]))
+						break;
+				}
+				if (mode == NUMMODES) {
+					setup_abort(my_rank,
+						    "unknown mode '%s'",
+						    optarg);
+				}
+				first_mode = last_mode = mode;
+				break;
+			case 'W':
+				window = atoi(optarg);
+				if (window < 1) window = 1;
+				break;
+			case 'r':
+				rounds = atoi(optarg);
+				break;
+			case 'p':
+				if (stat_eval_set_percentiles(optarg)) {
+					setup_abort(my_rank, "invalid "
+						    "percentile list '%s'",
+						    optarg);
+				}
+				break;
+			case 'L':
+				maxlen = atoi(optarg);
+				break;
+			case 'a':
+				adaptive_target = atof(optarg);
+				break;
+			case 'b':
+				adaptive_budget = atof(optarg);
+				break;
+			case 'n':
+				adaptive_batch = atoi(optarg);
+				break;
+			case 'h':
+				if (my_rank == 0) {
+					printf("usage %s [-P pairing "
+					       "(def: %s)] "
+					       "[-s seed for random pairing] "
+					       "[-m pingpong|stream|bidir|all "
+					       "(def: pingpong)] "
+					       "[-W window (def: %d)] "
+					       "[-r rounds (def: %d, windowed: "
+					       "%d)] "
+					       "[-p percentiles (def: "
+					       "99,99.9,99.99)] "
+					       "[-L max_length (def: %d)] "
+					       "[-a target CI width in %% of "
+					       "the median] "
+					       "[-b time budget per size in s] "
+					       "[-n rounds between CI checks "
+					       "(def: %d)] ",
+					       argv[0], DEFAULTPAIRING,
+					       DEFAULTWINDOW, NUMROUNDS,
+					       STREAMROUNDS, DEFAULTLEN,
+					       ADAPTIVE_DEFAULT_BATCH);
+					setup_usage(stdout, false);
+					printf("\nwith -a, rounds is the "
+					       "maximum (def: %d)\n"
+					       "pairings: neighbors half "
+					       "random intra inter\n",
+					       ADAPTIVEMAXROUNDS);
+				}
+				exit(0);
+			default:
+				setup_parse(&setup, arg, optarg);
+				break;
+		}
+	}
+
+	if (num_ranks < 2) {
 		if (my_rank == 0)
 			fprintf(stderr,
-				"Pingpong needs exactly two UEs; "
+				"Pingpong needs at least two UEs; "
 				"try again\n");
 		exit(-1);
 	}
 
-	remote_rank = (my_rank + 1) % 2;
+	pairing_setup(MPI_COMM_WORLD, pairing_mode, seed, &pairing);
+	if (pairing.num_pairs == 0) {
+		if (my_rank == 0)
+			fprintf(stderr, "No pairs for pairing '%s'; try "
+				"again\n", pairing_name(pairing_mode));
+		exit(-1);
+	}
+	remote_rank = pairing.partner;
+
+	/* select and calibrate the time source */
+	setup_timer(&setup);
+
+	/* allocate the message buffers */
+	if (maxlen < 1) maxlen = 1;
+	/* the sweeps end at the largest power of two up to maxlen */
+	for (last_length = 1; 2 * last_length <= maxlen; last_length *= 2)
+		;
+	setup_buffer(&setup, &send_mem, maxlen);
+	send_buffer = send_mem.ptr;
+#ifdef _USE_SEPARATED_BUFFERS_
+	setup_buffer(&setup, &recv_mem, maxlen);
+	recv_buffer = recv_mem.ptr;
+#else
+	recv_buffer = send_buffer;
+	if (last_mode != MODE_PINGPONG)
+		setup_buffer(&setup, &recv_mem, maxlen);
+#endif
+	window_buffer = recv_mem.ptr;
+
+	/* adaptive runs stop at the latest after the given rounds */
+	if (adaptive_target > 0) {
+		if (rounds <= 0) rounds = ADAPTIVEMAXROUNDS;
+		adaptive_init(&adapt, adaptive_target, adaptive_budget,
+			      adaptive_batch);
+		adaptive = &adapt;
+	}
+
+	/* one sample buffer for all sizes and modes */
+	if (rounds <= 0)
+		i = (NUMROUNDS > STREAMROUNDS) ? NUMROUNDS : STREAMROUNDS;
+	else
+		i = rounds;
+	time_stamps = (double *)calloc(sizeof(double), i);
+	memset(&report, 0, sizeof(report));
+	if (my_rank == 0) {
+		report.pooled =
+		    (double *)calloc(sizeof(double), i * pairing.num_pairs);
+		report.counts = (int *)calloc(sizeof(int), num_ranks);
+		report.displs = (int *)calloc(sizeof(int), num_ranks);
+		report.first_lat =
+		    (double *)malloc(sizeof(double) * pairing.num_pairs);
+		report.last_bw =
+		    (double *)malloc(sizeof(double) * pairing.num_pairs);
+	}
+	requests = (MPI_Request *)malloc(sizeof(MPI_Request) * 2 * window);
 
 	printf("Rank: %d; PID: %d\n", my_rank, getpid());
+	if (my_rank == 0) {
+		setup_print(&setup, true);
+		if (adaptive) {
+			printf("#adaptive: %.2f%% (%d%% CI of the median, "
+			       "batch %u, max. %d rounds", adapt.target,
+			       ADAPTIVE_CONFIDENCE, adapt.batch, rounds);
+			if (adapt.budget > 0)
+				printf(", budget %g s", adapt.budget);
+			printf(")\n");
+		}
+	}
 
 #ifdef _EXTENDED_ERROR_CHECK_
 	unsigned char my_mask, rem_mask;
 
 	/* intialize the buffers */
-	if (my_rank == 0) {
+	if (pairing.initiator) {
 		my_mask = SEND_MASK;
 		rem_mask = RECV_MASK;
-		for (i = 0; i < MAXBUFSIZE; ++i) {
+		for (i = 0; i < maxlen; ++i) {
 			send_buffer[i] = my_mask;
 			recv_buffer[i] = 0x42;
 		}
 	} else {
 		my_mask = RECV_MASK;
 		rem_mask = SEND_MASK;
-		for (i = 0; i < MAXBUFSIZE; ++i) {
+		for (i = 0; i < maxlen; ++i) {
 			send_buffer[i] = my_mask;
 			recv_buffer[i] = 0x42;
 		}
 	}
 #endif
 
-	if (my_rank == 0) printf("#bytes\t\tusec\t\tMB/sec\n");
-
-	if (my_rank == 0) {
-		for (length = 1; length <= maxlen; length *= 2) {
-#ifdef _CACHE_WARM_UP_
-			for (i = 0; i < length; i++) {
-				/* cache warm-up: */
-				dummy += send_buffer[i];
-				dummy += recv_buffer[i];
-			}
-#endif
-
-			/* synchronize before starting PING-PONG: */
-			MPI_Barrier(MPI_COMM_WORLD);
-
-			for (round = 0; round < numrounds + WARM_UP; round++) {
-#ifdef _ERROR_CHECK_
-				for (i = 0; i < length; i++) {
-					send_buffer[i] =
-					    (i + length + round) % 127;
-				}
-#endif
-
-				/* send PING: */
-				MPI_Ssend(send_buffer, length, MPI_CHAR,
-					  remote_rank, 0, MPI_COMM_WORLD);
-
-				/* recv PONG: */
-				MPI_Recv(recv_buffer, length, MPI_CHAR,
-					 remote_rank, 0, MPI_COMM_WORLD,
-					 &status);
-
-				/* start timer: */
-				if (round == WARM_UP - 1) timer = MPI_Wtime();
-
-#ifdef _ERROR_CHECK_
-				for (i = 0; i < length; i++) {
-					if (recv_buffer[i] !=
-					    (i + length + round) % 127) {
-						fprintf(
-						    stderr,
-						    "ERROR: %d VS %d at %d\n",
-						    recv_buffer[i],
-						    (i + length + round) % 127,
-						    i);
-						exit(-1);
-					}
-				}
-#endif
-			}
-
-			/* stop timer: */
-			timer = MPI_Wtime() - timer;
+	for (mode = first_mode; mode <= last_mode; ++mode) {
+		/* usec are per message, MB/sec count both directions (bidir) */
+		if (mode == MODE_PINGPONG)
+			numrounds = (rounds > 0) ? rounds : NUMROUNDS;
+		else
+			numrounds = (rounds > 0) ? rounds : STREAMROUNDS;
 
-			printf("%d\t\t%1.2lf\t\t%1.2lf\n", length,
-			       timer / (2.0 * numrounds) * 1000000,
-			       (length / (timer / (2.0 * numrounds))) /
-				   (1024 * 1024));
-			fflush(stdout);
+		if (my_rank == 0) {
+			for (i = 0; i < pairing.num_pairs; ++i)
+				report.first_lat[i] = -1;
+			if (mode != MODE_PINGPONG)
+				printf("#mode: %s (window %d)\n",
+				       mode_names[mode], window);
+			if (pairing.num_pairs == 1)
+				printf("#bytes\t\tusec\t\tMB/sec");
+			else
+				printf("#%d pairs (%s)\n#bytes\t\tusec\t\t"
+				       "MB/sec\t\taggr-MB/sec\tmin-MB/sec\t"
+				       "max-MB/sec", pairing.num_pairs,
+				       pairing_name(pairing_mode));
+			printf("\t\tmedian\t\tl-quartil\tu-quartil\ttail%s\n",
+			       adaptive ? "\t\trounds\t\tci-width" : "");
 		}
-	} else {
+
 		for (length = 1; length <= maxlen; length *= 2) {
-#ifdef _CACHE_WARM_UP_
-			for (i = 0; i < length; i++) {
-				/* cache warm-up: */
-				dummy += send_buffer[i];
-				dummy += recv_buffer[i];
+			/* bidir messages travel in both directions */
+			bytes_per_msg = (mode == MODE_BIDIR) ? 2.0 * length
+							     : length;
+			if (pairing.initiator || (pairing.partner != -1)) {
+				size_rounds = measure_size(mode, length,
+							   numrounds, window,
+							   remote_rank,
+							   pairing.initiator,
+							   requests,
+							   time_stamps);
+			} else {
+				/* unpaired ranks only synchronize */
+				size_rounds = idle_size(numrounds);
 			}
-#endif
 
-			/* synchronize before starting PING-PONG: */
-			MPI_Barrier(MPI_COMM_WORLD);
-
-			for (round = 0; round < numrounds + WARM_UP; round++) {
-#ifdef _ERROR_CHECK_
-				for (i = 0; i < length; i++) {
-					send_buffer[i] =
-					    (i + length + round) % 127;
-				}
-#endif
-
-				/* recv PING: */
-				MPI_Recv(recv_buffer, length, MPI_CHAR,
-					 remote_rank, 0, MPI_COMM_WORLD,
-					 &status);
+			/* collect the samples of all pairs on rank 0 */
+			report_size(&pairing, &report, time_stamps, length,
+				    size_rounds, bytes_per_msg);
+		}
 
-				/* send PONG: */
-				MPI_Ssend(send_buffer, length, MPI_CHAR,
-					  remote_rank, 0, MPI_COMM_WORLD);
+		/* per pair: smallest-size latency, largest-size bandwidth */
+		if ((my_rank == 0) && (pairing.num_pairs > 1)) {
+			printf("#pair\tranks\t\tnodes\t\tusec(1B)\t"
+			       "MB/sec(%dB)\n", last_length);
+			for (i = 0; i < pairing.num_pairs; ++i) {
+				int initiator = pairing.initiators[i];
+				int partner = pairing.partners[initiator];
 
-#ifdef _ERROR_CHECK_
-				for (i = 0; i < length; i++) {
-					if (recv_buffer[i] !=
-					    (i + length + round) % 127) {
-						fprintf(
-						    stderr,
-						    "ERROR: %d VS %d at %d\n",
-						    recv_buffer[i],
-						    (i + length + round) % 127,
-						    i);
-						exit(-1);
-					}
-				}
-#endif
+				printf("#%d\t%d-%d\t\t%d-%d\t\t%1.2lf\t\t"
+				       "%1.2lf\n", i, initiator, partner,
+				       pairing.nodes[initiator],
+				       pairing.nodes[partner],
+				       report.first_lat[i], report.last_bw[i]);
 			}
 		}
 	}
 
 #ifdef _EXTENDED_ERROR_CHECK_
 	printf("Perform error check ...\n");
-	for (i = 0; i < MAXBUFSIZE; ++i) {
+	for (i = 0; i < maxlen; ++i) {
 		if (recv_buffer[i] != rem_mask) {
 			fprintf(stderr,
 				"got: buf[%u] = 0x%x\n"
@@ -214,6 +593,16 @@ int main(int argc, char **argv) {
 		}
 	}
 #endif
+	free(requests);
+	free(time_stamps);
+	free(report.pooled);
+	free(report.counts);
+	free(report.displs);
+	free(report.first_lat);
+	free(report.last_bw);
+	pairing_free(&pairing);
+	buffer_free(&send_mem);
+	buffer_free(&recv_mem);
 	MPI_Finalize();
 
 	return 0;
@@ -0,0 +1,413 @@
+/*
+ * Copyright 2017, Simon Pickartz Institute for Automation of Complex Power
+ * Systems,
+ *                                RWTH Aachen University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Ping-pong with requests that are set up once per message size:
+ *   - blocking:    MPI_Send()/MPI_Recv(), as in pingpong_lat
+ *   - persistent:  MPI_Send_init()/MPI_Recv_init(), MPI_Start() per round
+ *   - partitioned: MPI_Psend_init()/MPI_Precv_init() (MPI-4); the OpenMP
+ *                  threads mark their partitions ready with MPI_Pready()
+ * With requests, the initiator starts the receive of the pong before it
+ * sends the ping; the responder starts its receive only when it waits for
+ * the ping. Besides the one-way latency the initiator times its send phase
+ * (until the send completes locally), i.e., the per-message overhead of the
+ * sender.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <mpi.h>
+#include <omp.h>
+
+#include <buffer.h>
+#include <pairing.h>
+#include <pingpong.h>
+#include <setup.h>
+#include <stat_eval.h>
+#include <timer.h>
+
+#define DEFAULTLEN (1)
+#define DEFAULTMAXLEN (1024 * 1024)
+#define DEFAULTROUNDS (1000)
+#define WARMUPROUNDS (100)
+#define DEFAULTPARTITIONS (8)
+#define DEFAULTPAIRING "neighbors"
+
+#if MPI_VERSION >= 4
+#define HAVE_PARTITIONED
+#endif
+
+/* message buffers; active send and receive requests must not share one */
+buffer_t send_mem, recv_mem;
+
+/* requests of the current size */
+pingpong_req_t req = {MPI_REQUEST_NULL, MPI_REQUEST_NULL};
+
+/* benchmark configuration */
+int32_t remote_rank;
+uint32_t partitions = DEFAULTPARTITIONS;
+bool threaded_pready = false;
+
+/* a ping-pong variant; initiate() returns the duration of the send phase */
+typedef struct _persist_kernel_t {
+	const char *name;
+	bool (*applies)(uint32_t length);	/* NULL: all sizes */
+	void (*setup)(uint32_t length);		/* NULL: no requests */
+	double (*initiate)(uint32_t length);
+	void (*respond)(uint32_t length);
+} persist_kernel_t;
+
+static double initiate_blocking(uint32_t length) {
+	double send_time;
+
+	pingpong_initiate(send_mem.ptr, recv_mem.ptr, length, remote_rank,
+			  MPI_COMM_WORLD, &send_time);
+
+	return send_time;
+}
+
+static void respond_blocking(uint32_t length) {
+	pingpong_respond(send_mem.ptr, recv_mem.ptr, length, remote_rank,
+			 MPI_COMM_WORLD);
+}
+
+static void setup_persistent(uint32_t length) {
+	pingpong_req_init(&req, send_mem.ptr, recv_mem.ptr, length,
+			  remote_rank, MPI_COMM_WORLD);
+}
+
+static double initiate_persistent(uint32_t length) {
+	double send_time;
+
+	(void)length;
+	pingpong_req_initiate(&req, NULL, &send_time);
+
+	return send_time;
+}
+
+static void respond_persistent(uint32_t length) {
+	(void)length;
+	pingpong_req_respond(&req, NULL);
+}
+
+#ifdef HAVE_PARTITIONED
+/* 'partitions' equal parts of the message */
+static bool applies_partitioned(uint32_t length) {
+	return (length >= partitions) && !(length % partitions);
+}
+
+static void setup_partitioned(uint32_t length) {
+	MPI_Psend_init(send_mem.ptr, partitions, length / partitions,
+		       MPI_CHAR, remote_rank, PINGPONG_TAG, MPI_COMM_WORLD,
+		       MPI_INFO_NULL, &req.send);
+	MPI_Precv_init(recv_mem.ptr, partitions, length / partitions,
+		       MPI_CHAR, remote_rank, PINGPONG_TAG, MPI_COMM_WORLD,
+		       MPI_INFO_NULL, &req.recv);
+}
+
+/* the threads mark the partitions of the started send */
+static void ready_partitions(MPI_Request send) {
+	int partition;
+
+#pragma omp parallel for if (threaded_pready)
+	for (partition = 0; partition < (int)partitions; ++partition)
+		MPI_Pready(partition, send);
+}
+
+static double initiate_partitioned(uint32_t length) {
+	double send_time;
+
+	(void)length;
+	pingpong_req_initiate(&req, ready_partitions, &send_time);
+
+	return send_time;
+}
+
+static void respond_partitioned(uint32_t length) {
+	(void)length;
+	pingpong_req_respond(&req, ready_partitions);
+}
+#endif
+
+static const persist_kernel_t persist_kernels[] = {
+    {"blocking", NULL, NULL, initiate_blocking, respond_blocking},
+    {"persistent", NULL, setup_persistent, initiate_persistent,
+     respond_persistent},
+#ifdef HAVE_PARTITIONED
+    {"partitioned", applies_partitioned, setup_partitioned,
+     initiate_partitioned, respond_partitioned},
+#endif
+};
+#define NUMKERNELS (sizeof(persist_kernels) / sizeof(persist_kernels[0]))
+
+/* release the requests of the current size */
+static void teardown(void) {
+	pingpong_req_free(&req);
+}
+
+/*
+ * median one-way latency and send overhead (usec) of this pair (0 if
+ * unpaired); false if the variant does not apply to the size
+ */
+static bool measure_kernel(const persist_kernel_t *kernel,
+			   const pairing_t *pairing, uint32_t length,
+			   int32_t numrounds, double *samples,
+			   double *overheads, double *lat, double *ovh) {
+	stat_eval_t stat_eval;
+	double timer, send_time;
+	int32_t round;
+
+	*lat = *ovh = 0;
+	if (kernel->applies && !kernel->applies(length)) return false;
+	MPI_Barrier(MPI_COMM_WORLD);
+	if (pairing->partner == -1) return true;
+	if (kernel->setup) kernel->setup(length);
+
+	for (round = -WARMUPROUNDS; round < numrounds; ++round) {
+		if (!pairing->initiator) {
+			kernel->respond(length);
+			continue;
+		}
+
+		/* start timer: */
+		timer = timer_now();
+
+		send_time = kernel->initiate(length);
+
+		/* stop timer: */
+		timer = timer_elapsed(timer);
+		if (round >= 0) {
+			samples[round] = timer * 1e6 / 2;
+			overheads[round] = send_time * 1e6;
+		}
+	}
+	teardown();
+	if (!pairing->initiator) return true;
+
+	statistical_eval(samples, numrounds, &stat_eval);
+	*lat = stat_eval.box_plot.median;
+	statistical_eval(overheads, numrounds, &stat_eval);
+	*ovh = stat_eval.box_plot.median;
+
+	return true;
+}
+
+int main(int argc, char **argv) {
+	int arg;
+#ifdef HAVE_PARTITIONED
+	int provided;
+#endif
+	uint32_t i;
+	int32_t num_ranks;
+	int32_t my_rank;
+
+	uint32_t length = DEFAULTLEN;
+	uint32_t maxlen = DEFAULTMAXLEN;
+	uint32_t cur_len;
+	int32_t numrounds = DEFAULTROUNDS;
+	pairing_mode_t pairing_mode = PAIRING_NEIGHBORS;
+	pairing_t pairing;
+	uint32_t seed = 0;
+	setup_t setup;
+	FILE *output = stdout;
+
+	double *samples, *overheads;
+	char label[32];
+	bool applies[NUMKERNELS];
+	double vals[2 * NUMKERNELS], mean_vals[2 * NUMKERNELS];
+
+#ifdef HAVE_PARTITIONED
+	/*
+	 * concurrent MPI_Pready() calls need MPI_THREAD_MULTIPLE, which slows
+	 * down many libraries (also the blocking and persistent baselines);
+	 * it is only requested if there are threads to mark the partitions
+	 */
+	if (omp_get_max_threads() > 1) {
+		MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+		threaded_pready = (provided == MPI_THREAD_MULTIPLE);
+	} else {
+		MPI_Init(&argc, &argv);
+	}
+#else
+	MPI_Init(&argc, &argv);
+#endif
+	MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+	setup_init(&setup, my_rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+
+	/* determine arguments */
+	while ((arg = getopt(argc, argv,
+			     "l:L:r:p:P:s:f:h" SETUP_OPTIONS)) != -1) {
+		switch (arg) {
+			case 'l':
+				length = atoi(optarg);
+				break;
+			case 'L':
+				maxlen = atoi(optarg);
+				break;
+			case 'r':
+				numrounds = atoi(optarg);
+				break;
+			case 'p':
+				partitions = atoi(optarg);
+				break;
+			case 'P':
+				if (pairing_parse(optarg, &pairing_mode)) {
+					setup_abort(my_rank,
+						    "unknown pairing '%s'",
+						    optarg);
+				}
+				break;
+			case 's':
+				seed = atoi(optarg);
+				break;
+			case 'h':
+				if (my_rank == 0) {
+					printf(
+					    "usage %s [-l message_length "
+					    "(def: %d)] "
+					    "[-L max. message_length "
+					    "(def: %d)] "
+					    "[-r rounds (def: %d)] "
+					    "[-p partitions (def: %d)] "
+					    "[-P pairing (def: %s)] "
+					    "[-s seed for random pairing] ",
+					    argv[0], DEFAULTLEN, DEFAULTMAXLEN,
+					    DEFAULTROUNDS, DEFAULTPARTITIONS,
+					    DEFAULTPAIRING);
+					setup_usage(stdout, true);
+					printf("\nthreads: OMP_NUM_THREADS; "
+					       "more than one requests "
+					       "MPI_THREAD_MULTIPLE\n"
+					       "pairings: neighbors half "
+					       "random intra inter\n");
+					fflush(stdout);
+				}
+				exit(0);
+			default:
+				setup_parse(&setup, arg, optarg);
+				break;
+		}
+	}
+
+	if (num_ranks < 2) {
+		setup_abort(my_rank, "at least 2 ranks are required");
+	}
+	if (numrounds < 1) numrounds = 1;
+	if (partitions < 1) partitions = 1;
+	if (maxlen < length) maxlen = length;
+
+	pairing_setup(MPI_COMM_WORLD, pairing_mode, seed, &pairing);
+	if (pairing.num_pairs == 0) {
+		setup_abort(my_rank, "no pairs for pairing '%s'",
+			    pairing_name(pairing_mode));
+	}
+	remote_rank = pairing.partner;
+
+	/* select and calibrate the time source */
+	setup_timer(&setup);
+
+	setup_buffer(&setup, &send_mem, maxlen);
+	setup_buffer(&setup, &recv_mem, maxlen);
+	memset(send_mem.ptr, 1, send_mem.length);
+	samples = (double *)malloc(sizeof(double) * numrounds);
+	overheads = (double *)malloc(sizeof(double) * numrounds);
+
+	if (my_rank == 0) {
+		printf("Starting the benchmark:\n");
+		printf("Rounds     : %10d\n", numrounds);
+		printf("Msg Length : %10d - %d\n", length, maxlen);
+		printf("Pairing    : %10s (%d pairs)\n",
+		       pairing_name(pairing_mode), pairing.num_pairs);
+#ifdef HAVE_PARTITIONED
+		printf("Partitions : %10u (MPI_Pready by %s)\n", partitions,
+		       threaded_pready ? "all threads" : "the master thread");
+		printf("Threading  : %10s\n",
+		       threaded_pready ? "multiple" : "single");
+		printf("Threads    : %10d\n", omp_get_max_threads());
+#else
+		printf("Partitions :        n/a (MPI-%d.%d has no partitioned "
+		       "communication)\n", MPI_VERSION, MPI_SUBVERSION);
+#endif
+		setup_print(&setup, false);
+	}
+
+	output = setup_output(&setup);
+	if (my_rank == 0) {
+		fprintf(output, "#%9s", "bytes");
+		for (i = 0; i < NUMKERNELS; ++i)
+			fprintf(output, " %14s", persist_kernels[i].name);
+		for (i = 0; i < NUMKERNELS; ++i) {
+			snprintf(label, sizeof(label), "%s-ovh",
+				 persist_kernels[i].name);
+			fprintf(output, " %14s", label);
+		}
+		fprintf(output, "\n");
+	}
+
+	/* latency and send overhead (usec), averaged over the pairs */
+	cur_len = length;
+	for (;;) {
+		for (i = 0; i < NUMKERNELS; ++i)
+			applies[i] = measure_kernel(&persist_kernels[i],
+						    &pairing, cur_len,
+						    numrounds, samples,
+						    overheads, &vals[i],
+						    &vals[NUMKERNELS + i]);
+
+		/* only the initiators contribute */
+		MPI_Reduce(vals, mean_vals, 2 * NUMKERNELS, MPI_DOUBLE,
+			   MPI_SUM, 0, MPI_COMM_WORLD);
+		if (my_rank == 0) {
+			fprintf(output, "%10u", cur_len);
+			for (i = 0; i < 2 * NUMKERNELS; ++i) {
+				if (applies[i % NUMKERNELS])
+					fprintf(output, " %14.2f",
+						mean_vals[i] /
+						    pairing.num_pairs);
+				else
+					fprintf(output, " %14s", "n/a");
+			}
+			fprintf(output, "\n");
+			fflush(output);
+		}
+
+		/* power-of-two sweep */
+		if (cur_len >= maxlen) break;
+		cur_len = cur_len ? cur_len * 2 : 1;
+		if (cur_len > maxlen) cur_len = maxlen;
+	}
+
+	setup_close(&setup);
+
+	free(samples);
+	free(overheads);
+	pairing_free(&pairing);
+	buffer_free(&send_mem);
+	buffer_free(&recv_mem);
+
+	MPI_Finalize();
+
+	return 0;
+}
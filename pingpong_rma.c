@@ -0,0 +1,445 @@
+/*
+ * Copyright 2017, Simon Pickartz Institute for Automation of Complex Power
+ * Systems,
+ *                                RWTH Aachen University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Ping-pong over one-sided communication next to MPI_Send()/MPI_Recv():
+ *   - shm: MPI_Win_allocate_shared() window of the node; the sender copies
+ *          the message into the partner's segment and raises a flag that
+ *          the partner polls (C11 atomics); measured by the intra-node
+ *          pairs only and compared with their two-sided latency
+ *   - put: MPI_Put() into the partner's window followed by an atomic flag
+ *          update, both completed by MPI_Win_flush() (passive target)
+ *   - get: the partner is signaled and pulls the message with MPI_Get()
+ * Every variant runs over the whole size sweep; the table lists the
+ * one-way latency (median of the round trips / 2, averaged over the pairs)
+ * of all variants and their ratio to the two-sided numbers.
+ */
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <mpi.h>
+
+#include <buffer.h>
+#include <pairing.h>
+#include <pingpong.h>
+#include <setup.h>
+#include <stat_eval.h>
+#include <timer.h>
+
+#define DEFAULTLEN (1)
+#define DEFAULTMAXLEN (1024 * 1024)
+#define DEFAULTROUNDS (1000)
+#define WARMUPROUNDS (100)
+#define DEFAULTPAIRING "neighbors"
+#define FLAGBYTES (64) /* the flag has a cache line of its own */
+
+/* message buffer of the two-sided transfers and source of all others */
+buffer_t send_mem;
+
+/* window segments: a flag followed by the message */
+MPI_Win shm_win = MPI_WIN_NULL;
+MPI_Win rma_win = MPI_WIN_NULL;
+unsigned char *shm_local = NULL;
+unsigned char *shm_remote = NULL;
+
+/* pair and sequence number of the current round (the same on both sides) */
+int32_t my_rank;
+int32_t remote_rank;
+uint64_t seq = 0;
+
+/* a ping-pong variant: one round trip of the initiator or the responder */
+typedef struct _rma_kernel_t {
+	const char *name;
+	void (*initiate)(uint32_t length);
+	void (*respond)(uint32_t length);
+	bool shared;	/* needs both ranks on the same node */
+} rma_kernel_t;
+
+static void initiate_two_sided(uint32_t length) {
+	pingpong_initiate(send_mem.ptr, send_mem.ptr, length, remote_rank,
+			  MPI_COMM_WORLD, NULL);
+}
+
+static void respond_two_sided(uint32_t length) {
+	pingpong_respond(send_mem.ptr, send_mem.ptr, length, remote_rank,
+			 MPI_COMM_WORLD);
+}
+
+static void shm_send(uint32_t length) {
+	memcpy(shm_remote + FLAGBYTES, send_mem.ptr, length);
+	atomic_store_explicit((_Atomic uint64_t *)shm_remote, seq,
+			      memory_order_release);
+}
+
+static void shm_wait(void) {
+	while (atomic_load_explicit((_Atomic uint64_t *)shm_local,
+				    memory_order_acquire) != seq)
+		;
+}
+
+static void initiate_shm(uint32_t length) {
+	shm_send(length);
+	shm_wait();
+}
+
+static void respond_shm(uint32_t length) {
+	shm_wait();
+	shm_send(length);
+}
+
+/* atomic flag update in the target's window, complete on return */
+static void rma_signal(int32_t target) {
+	MPI_Accumulate(&seq, 1, MPI_UINT64_T, target, 0, 1, MPI_UINT64_T,
+		       MPI_REPLACE, rma_win);
+	MPI_Win_flush(target, rma_win);
+}
+
+/* poll the own flag through the window */
+static void rma_wait(void) {
+	uint64_t flag;
+
+	do {
+		MPI_Fetch_and_op(NULL, &flag, MPI_UINT64_T, my_rank, 0,
+				 MPI_NO_OP, rma_win);
+		MPI_Win_flush(my_rank, rma_win);
+	} while (flag != seq);
+}
+
+/* the data is complete at the target before the flag is raised */
+static void rma_put(uint32_t length) {
+	MPI_Put(send_mem.ptr, length, MPI_BYTE, remote_rank, FLAGBYTES, length,
+		MPI_BYTE, rma_win);
+	MPI_Win_flush(remote_rank, rma_win);
+	rma_signal(remote_rank);
+}
+
+static void initiate_put(uint32_t length) {
+	rma_put(length);
+	rma_wait();
+}
+
+static void respond_put(uint32_t length) {
+	rma_wait();
+	rma_put(length);
+}
+
+static void rma_get(uint32_t length) {
+	MPI_Get(send_mem.ptr, length, MPI_BYTE, remote_rank, FLAGBYTES, length,
+		MPI_BYTE, rma_win);
+	MPI_Win_flush(remote_rank, rma_win);
+}
+
+static void initiate_get(uint32_t length) {
+	rma_signal(remote_rank);
+	rma_wait();
+	rma_get(length);
+}
+
+static void respond_get(uint32_t length) {
+	rma_wait();
+	rma_get(length);
+	rma_signal(remote_rank);
+}
+
+/* the reference comes first */
+static const rma_kernel_t rma_kernels[] = {
+    {"two-sided", initiate_two_sided, respond_two_sided, false},
+    {"shm", initiate_shm, respond_shm, true},
+    {"put", initiate_put, respond_put, false},
+    {"get", initiate_get, respond_get, false},
+};
+#define NUMKERNELS (sizeof(rma_kernels) / sizeof(rma_kernels[0]))
+
+/* number of pairs within a node */
+static int32_t pairs_intra_node(const pairing_t *pairing) {
+	int32_t pair, initiator, num_intra = 0;
+
+	for (pair = 0; pair < pairing->num_pairs; ++pair) {
+		initiator = pairing->initiators[pair];
+		if (pairing->nodes[initiator] ==
+		    pairing->nodes[pairing->partners[initiator]])
+			num_intra++;
+	}
+
+	return num_intra;
+}
+
+/*
+ * create the node window (collective) and map the partner's segment if
+ * the pair is within the node
+ */
+static void shm_setup(MPI_Comm node_comm, uint32_t maxlen,
+		      const pairing_t *pairing, bool pair_intra) {
+	MPI_Group world_group, node_group;
+	MPI_Aint size;
+	int disp_unit, node_partner;
+
+	MPI_Win_allocate_shared(FLAGBYTES + maxlen, 1, MPI_INFO_NULL,
+				node_comm, &shm_local, &shm_win);
+	memset(shm_local, 0, FLAGBYTES);
+	MPI_Win_lock_all(MPI_MODE_NOCHECK, shm_win);
+	MPI_Win_sync(shm_win);
+	if ((pairing->partner == -1) || !pair_intra) return;
+
+	MPI_Comm_group(MPI_COMM_WORLD, &world_group);
+	MPI_Comm_group(node_comm, &node_group);
+	MPI_Group_translate_ranks(world_group, 1, &remote_rank, node_group,
+				  &node_partner);
+	MPI_Group_free(&world_group);
+	MPI_Group_free(&node_group);
+	MPI_Win_shared_query(shm_win, node_partner, &size, &disp_unit,
+			     &shm_remote);
+}
+
+/*
+ * median one-way latency (usec) of this pair, 0 if unpaired or if the
+ * kernel needs a node-local pair
+ */
+static double measure_kernel(const rma_kernel_t *kernel,
+			     const pairing_t *pairing, bool pair_intra,
+			     uint32_t length, int32_t numrounds,
+			     double *samples) {
+	stat_eval_t stat_eval;
+	double timer;
+	int32_t round;
+
+	MPI_Barrier(MPI_COMM_WORLD);
+	if (pairing->partner == -1) return 0;
+	if (kernel->shared && !pair_intra) return 0;
+
+	for (round = -WARMUPROUNDS; round < numrounds; ++round) {
+		++seq;
+		if (!pairing->initiator) {
+			kernel->respond(length);
+			continue;
+		}
+
+		/* start timer: */
+		timer = timer_now();
+
+		kernel->initiate(length);
+
+		/* stop timer: */
+		timer = timer_elapsed(timer);
+		if (round >= 0) samples[round] = timer * 1e6 / 2;
+	}
+	if (!pairing->initiator) return 0;
+	statistical_eval(samples, numrounds, &stat_eval);
+
+	return stat_eval.box_plot.median;
+}
+
+int main(int argc, char **argv) {
+	int arg;
+	uint32_t i;
+	int32_t num_ranks;
+
+	uint32_t length = DEFAULTLEN;
+	uint32_t maxlen = DEFAULTMAXLEN;
+	uint32_t cur_len;
+	int32_t numrounds = DEFAULTROUNDS;
+	pairing_mode_t pairing_mode = PAIRING_NEIGHBORS;
+	pairing_t pairing;
+	uint32_t seed = 0;
+	setup_t setup;
+	FILE *output = stdout;
+
+	MPI_Comm node_comm;
+	unsigned char *rma_base;
+	bool pair_intra;
+	int32_t num_intra;
+	double *samples;
+	/* the last entry: two-sided latency of the intra-node pairs */
+	double lat[NUMKERNELS + 1], sum_lat[NUMKERNELS + 1], mean_lat;
+	int reference;
+
+	MPI_Init(&argc, &argv);
+	MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+	setup_init(&setup, my_rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+
+	/* determine arguments */
+	while ((arg = getopt(argc, argv,
+			     "l:L:r:P:s:f:h" SETUP_OPTIONS)) != -1) {
+		switch (arg) {
+			case 'l':
+				length = atoi(optarg);
+				break;
+			case 'L':
+				maxlen = atoi(optarg);
+				break;
+			case 'r':
+				numrounds = atoi(optarg);
+				break;
+			case 'P':
+				if (pairing_parse(optarg, &pairing_mode)) {
+					setup_abort(my_rank,
+						    "unknown pairing '%s'",
+						    optarg);
+				}
+				break;
+			case 's':
+				seed = atoi(optarg);
+				break;
+			case 'h':
+				if (my_rank == 0) {
+					printf(
+					    "usage %s [-l message_length "
+					    "(def: %d)] "
+					    "[-L max. message_length "
+					    "(def: %d)] "
+					    "[-r rounds (def: %d)] "
+					    "[-P pairing (def: %s)] "
+					    "[-s seed for random pairing] ",
+					    argv[0], DEFAULTLEN, DEFAULTMAXLEN,
+					    DEFAULTROUNDS, DEFAULTPAIRING);
+					setup_usage(stdout, true);
+					printf("\npairings: neighbors half "
+					       "random intra inter\n");
+					fflush(stdout);
+				}
+				exit(0);
+			default:
+				setup_parse(&setup, arg, optarg);
+				break;
+		}
+	}
+
+	if (num_ranks < 2) {
+		setup_abort(my_rank, "at least 2 ranks are required");
+	}
+	if (numrounds < 1) numrounds = 1;
+	if (maxlen < length) maxlen = length;
+
+	pairing_setup(MPI_COMM_WORLD, pairing_mode, seed, &pairing);
+	if (pairing.num_pairs == 0) {
+		setup_abort(my_rank, "no pairs for pairing '%s'",
+			    pairing_name(pairing_mode));
+	}
+	remote_rank = pairing.partner;
+
+	/* select and calibrate the time source */
+	setup_timer(&setup);
+
+	setup_buffer(&setup, &send_mem, maxlen);
+	memset(send_mem.ptr, 1, send_mem.length);
+
+	/* the windows are collective; every rank takes part */
+	num_intra = pairs_intra_node(&pairing);
+	pair_intra = (pairing.partner != -1) &&
+		     (pairing.nodes[my_rank] == pairing.nodes[pairing.partner]);
+	MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, my_rank,
+			    MPI_INFO_NULL, &node_comm);
+	shm_setup(node_comm, maxlen, &pairing, pair_intra);
+	MPI_Win_allocate(FLAGBYTES + maxlen, 1, MPI_INFO_NULL, MPI_COMM_WORLD,
+			 &rma_base, &rma_win);
+	memset(rma_base, 0, FLAGBYTES + maxlen);
+	MPI_Win_lock_all(MPI_MODE_NOCHECK, rma_win);
+	MPI_Win_sync(rma_win);
+	MPI_Barrier(MPI_COMM_WORLD);
+
+	samples = (double *)malloc(sizeof(double) * numrounds);
+
+	if (my_rank == 0) {
+		printf("Starting the benchmark:\n");
+		printf("Rounds     : %10d\n", numrounds);
+		printf("Msg Length : %10d - %d\n", length, maxlen);
+		printf("Pairing    : %10s (%d pairs, %d intra-node)\n",
+		       pairing_name(pairing_mode), pairing.num_pairs,
+		       num_intra);
+		setup_print(&setup, false);
+	}
+
+	output = setup_output(&setup);
+	if (my_rank == 0) {
+		fprintf(output, "#%9s", "bytes");
+		for (i = 0; i < NUMKERNELS; ++i)
+			fprintf(output, " %10s", rma_kernels[i].name);
+		for (i = 1; i < NUMKERNELS; ++i)
+			fprintf(output, " %7s/2s", rma_kernels[i].name);
+		fprintf(output, "\n");
+	}
+
+	cur_len = length;
+	for (;;) {
+		for (i = 0; i < NUMKERNELS; ++i)
+			lat[i] = measure_kernel(&rma_kernels[i], &pairing,
+						pair_intra, cur_len, numrounds,
+						samples);
+		lat[NUMKERNELS] = pair_intra ? lat[0] : 0;
+
+		/* only the initiators contribute */
+		MPI_Reduce(lat, sum_lat, NUMKERNELS + 1, MPI_DOUBLE, MPI_SUM,
+			   0, MPI_COMM_WORLD);
+		if (my_rank == 0) {
+			fprintf(output, "%10u", cur_len);
+			for (i = 0; i < NUMKERNELS; ++i) {
+				if (rma_kernels[i].shared && !num_intra) {
+					fprintf(output, " %10s", "n/a");
+					continue;
+				}
+				mean_lat = sum_lat[i] /
+					   (rma_kernels[i].shared
+						? num_intra
+						: pairing.num_pairs);
+				fprintf(output, " %10.2f", mean_lat);
+			}
+			/* shm against two-sided of the same pairs */
+			for (i = 1; i < NUMKERNELS; ++i) {
+				reference = rma_kernels[i].shared ? NUMKERNELS
+								  : 0;
+				if (rma_kernels[i].shared && !num_intra)
+					fprintf(output, " %10s", "n/a");
+				else
+					fprintf(output, " %10.2f",
+						sum_lat[i] /
+						    sum_lat[reference]);
+			}
+			fprintf(output, "\n");
+			fflush(output);
+		}
+
+		/* power-of-two sweep */
+		if (cur_len >= maxlen) break;
+		cur_len = cur_len ? cur_len * 2 : 1;
+		if (cur_len > maxlen) cur_len = maxlen;
+	}
+
+	setup_close(&setup);
+
+	MPI_Win_unlock_all(rma_win);
+	MPI_Win_free(&rma_win);
+	MPI_Win_unlock_all(shm_win);
+	MPI_Win_free(&shm_win);
+	MPI_Comm_free(&node_comm);
+
+	free(samples);
+	pairing_free(&pairing);
+	buffer_free(&send_mem);
+
+	MPI_Finalize();
+
+	return 0;
+}
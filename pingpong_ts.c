@@ -28,43 +28,128 @@
 
 #include <mpi.h>
 
+#include <buffer.h>
+#include <pairing.h>
+#include <pingpong.h>
+#include <ringlog.h>
+#include <setup.h>
+#include <stat_eval.h>
+#include <timer.h>
+
 #define _CACHE_WARM_UP_
-#undef _SHOW_PERIOD_
 
-#define MAXBUFSIZE (64)
 #define DEFAULTLEN (0)
 #define DEFAULTDELAY (1e6)
 #define DEFAULTROUNDS (10000)
 #define DEFAULTITER (1)
 #define WARMUPITER (10000)
+#define DEFAULTPAIRING "neighbors"
+#define DEFAULTSPIN (0)
+#define DEFAULTLOG "batch"
+#define FLUSHINTERVAL (1000000000) /* ns between batch drains */
 
-#define send_buffer buffer
-#define recv_buffer buffer
-unsigned char buffer[MAXBUFSIZE + 1];
+/* message buffer */
+buffer_t send_mem;
+unsigned char *send_buffer = NULL;
+#define recv_buffer send_buffer
 
 unsigned char dummy = 0;
 
+/* monotonic time in ns; the schedule does not depend on MPI_Wtime() */
+static inline int64_t now_ns(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*
+ * Wait for the absolute 'deadline': sleep until 'spin' ns before it and
+ * busy-wait for the rest to hide the wake-up latency of the scheduler
+ */
+static void sleep_until(int64_t deadline, int64_t spin) {
+	struct timespec ts;
+	int64_t wake = deadline - spin;
+
+	if (wake > now_ns()) {
+		ts.tv_sec = wake / 1000000000;
+		ts.tv_nsec = wake % 1000000000;
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts,
+				       NULL) == EINTR)
+			;
+	}
+	while (now_ns() < deadline)
+		;
+}
+
+/* pool the samples of all initiators on rank 0 and evaluate them there */
+static void report_schedule(const pairing_t *pairing, const char *name,
+			    double *samples, int count) {
+	int32_t pair, my_rank, num_ranks;
+	int *counts = NULL, *displs = NULL;
+	double *pooled = NULL;
+	stat_eval_t stat_eval;
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+	if (my_rank == 0) {
+		pooled = (double *)malloc(sizeof(double) *
+					  (size_t)count * pairing->num_pairs);
+		counts = (int *)calloc(sizeof(int), num_ranks);
+		displs = (int *)calloc(sizeof(int), num_ranks);
+		for (pair = 0; pair < pairing->num_pairs; ++pair) {
+			counts[pairing->initiators[pair]] = count;
+			displs[pairing->initiators[pair]] = pair * count;
+		}
+	}
+	MPI_Gatherv(samples, pairing->initiator ? count : 0, MPI_DOUBLE,
+		    pooled, counts, displs, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+	if ((my_rank == 0) && (count * pairing->num_pairs > 1)) {
+		statistical_eval(pooled, count * pairing->num_pairs,
+				 &stat_eval);
+		printf("##----------------------------------------------\n");
+		printf("#%s\n", name);
+		print_statistics(&stat_eval, count * pairing->num_pairs,
+				 stdout);
+	}
+
+	free(pooled);
+	free(counts);
+	free(displs);
+}
+
 int main(int argc, char **argv) {
 	int arg;
 	uint32_t i;
 	int32_t num_ranks;
 	int32_t remote_rank, my_rank;
 
-	useconds_t delay = DEFAULTDELAY;
+	double delay = DEFAULTDELAY;
+	double spin = DEFAULTSPIN;
 	uint32_t length = DEFAULTLEN;
 	uint32_t iterations = DEFAULTITER;
 	int32_t numrounds = DEFAULTROUNDS;
 	int32_t round;
 
 	double timer;
-#ifdef _SHOW_PERIOD_
-	double last_sleep = 0;
-#endif
+	int64_t period, deadline, start, last_start = 0, last_flush = 0;
+	uint64_t missed = 0, total_missed = 0;
+	double *periods = NULL;
+	double *lateness = NULL;
 	bool run_infinitely;
-	MPI_Status status;
+	pairing_mode_t pairing_mode = PAIRING_NEIGHBORS;
+	pairing_t pairing;
+	uint32_t seed = 0;
+	setup_t setup;
+	ringlog_mode_t log_mode = RINGLOG_BATCH;
+	bool log_cost = false;
+	ringlog_t log;
 
-	/* determine arguments */
-	while ((arg = getopt(argc, argv, "i:r:l:hd:")) != -1) {
+	/* determine arguments; before MPI_Init(), every rank reports errors */
+	setup_init(&setup, 0);
+	while ((arg = getopt(argc, argv,
+			     "i:r:l:hd:S:P:s:I:T" SETUP_OPTIONS)) != -1) {
 		switch (arg) {
 			case 'r':
 				numrounds = atoi(optarg);
@@ -78,31 +163,81 @@ int main(int argc, char **argv) {
 			case 'd':
 				delay = atof(optarg);
 				break;
+			case 'S':
+				spin = atof(optarg);
+				break;
+			case 'P':
+				if (pairing_parse(optarg, &pairing_mode))
+					setup_abort(setup.my_rank, "unknown "
+						    "pairing '%s'", optarg);
+				break;
+			case 's':
+				seed = atoi(optarg);
+				break;
+			case 'I':
+				if (ringlog_parse(optarg, &log_mode))
+					setup_abort(setup.my_rank, "unknown "
+						    "logging mode '%s'",
+						    optarg);
+				break;
+			case 'T':
+				log_cost = true;
+				break;
 			case 'h':
 				printf(
 				    "usage %s [-l message_length (def: %d)] "
 				    "[-i iterations (def: %d)] "
-				    "[-d delay in us (def: %f)] "
-				    "[-r rounds (def: %d)]\n",
+				    "[-d period in us (def: %f)] "
+				    "[-S busy-wait before deadline in us "
+				    "(def: %d)] "
+				    "[-r rounds (def: %d)] "
+				    "[-P pairing (def: %s)] "
+				    "[-s seed for random pairing] "
+				    "[-I direct|batch|thread round output "
+				    "(def: %s)] "
+				    "[-T (report the cost of the output)] ",
 				    argv[0], DEFAULTLEN, DEFAULTITER,
-				    DEFAULTDELAY, DEFAULTROUNDS);
+				    DEFAULTDELAY, DEFAULTSPIN, DEFAULTROUNDS,
+				    DEFAULTPAIRING, DEFAULTLOG);
+				setup_usage(stdout, false);
+				printf("\npairings: neighbors half random "
+				       "intra inter\n");
 				exit(0);
+			default:
+				setup_parse(&setup, arg, optarg);
+				break;
 		}
 	}
 
 	/* initialize MPI environment */
 	MPI_Init(&argc, &argv);
 	MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+	setup.my_rank = my_rank;
 	MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
 
 	/* check for errors and determine remote rank */
-	if (num_ranks != 2) {
+	if (num_ranks < 2) {
 		if (my_rank == 0)
-			fprintf(stderr, "%s needs exactly two UEs; try again\n",
+			fprintf(stderr,
+				"%s needs at least two UEs; try again\n",
 				argv[0]);
 		exit(-1);
 	}
-	remote_rank = (my_rank + 1) % 2;
+	pairing_setup(MPI_COMM_WORLD, pairing_mode, seed, &pairing);
+	if (pairing.num_pairs == 0) {
+		if (my_rank == 0)
+			fprintf(stderr, "No pairs for pairing '%s'; try "
+				"again\n", pairing_name(pairing_mode));
+		exit(-1);
+	}
+	remote_rank = pairing.partner;
+
+	/* select and calibrate the time source */
+	setup_timer(&setup);
+
+	/* allocate the message buffers */
+	setup_buffer(&setup, &send_mem, length);
+	send_buffer = send_mem.ptr;
 
 /* perform a warm-up of the cache */
 #ifdef _CACHE_WARM_UP_
@@ -118,7 +253,11 @@ int main(int argc, char **argv) {
 		run_infinitely = true;
 	} else {
 		run_infinitely = false;
+		periods = (double *)calloc(sizeof(double), numrounds);
+		lateness = (double *)calloc(sizeof(double), numrounds);
 	}
+	period = (int64_t)(delay * 1e3);
+	if (period < 1) period = 1;
 
 	if (my_rank == 0) {
 		printf("Starting the benchmark:\n");
@@ -129,76 +268,127 @@ int main(int argc, char **argv) {
 		}
 		printf("Iterations : %10d\n", iterations);
 		printf("Msg Length : %10d\n", length);
+		printf("Pairing    : %10s\n", pairing_name(pairing_mode));
+		printf("Pairs      : %10d\n", pairing.num_pairs);
+		setup_print(&setup, false);
+		printf("Period     : %10.2f us (busy-wait %.2f us)\n", delay,
+		       spin);
+		printf("Output     : %10s\n", ringlog_name(log_mode));
+		printf("#[pair]\tusec\t\tperiod\t\tlateness\n");
+		fflush(stdout);
 	}
 
 	/* synchronize and start the PingPong */
 	MPI_Barrier(MPI_COMM_WORLD);
-	if (my_rank == 0) {
-		for (i = 0; i < WARMUPITER; ++i) {
-			MPI_Send(send_buffer, length, MPI_CHAR, remote_rank, 0,
-				 MPI_COMM_WORLD);
-			MPI_Recv(recv_buffer, length, MPI_CHAR, remote_rank, 0,
-				 MPI_COMM_WORLD, &status);
-		}
+	if (pairing.initiator) {
+		for (i = 0; i < WARMUPITER; ++i)
+			pingpong_initiate(send_buffer, recv_buffer, length,
+					  remote_rank, MPI_COMM_WORLD, NULL);
 		MPI_Barrier(MPI_COMM_WORLD);
 
+		/* concurrent pairs are told apart by their id */
+		if (ringlog_init(&log, log_mode, RINGLOG_DEFAULT_CAPACITY,
+				 stdout, (pairing.num_pairs > 1)
+				     ? "%.0f\t%1.2lf\t\t%1.2lf\t\t%1.2lf\n"
+				     : "%1.2lf\t\t%1.2lf\t\t%1.2lf\n",
+				 log_cost)) {
+			setup_fail("cannot set up the output");
+		}
+
+		/* rounds start at absolute deadlines; no error accumulates */
+		deadline = now_ns() + period;
 		for (round = 0; run_infinitely || (round < numrounds);
 		     ++round) {
+			sleep_until(deadline, (int64_t)(spin * 1e3));
+			start = now_ns();
+
 			/* start timer: */
-			timer = MPI_Wtime();
-
-			for (i = 0; i < iterations; ++i) {
-				MPI_Send(send_buffer, length, MPI_CHAR,
-					 remote_rank, 0, MPI_COMM_WORLD);
-				MPI_Recv(recv_buffer, length, MPI_CHAR,
-					 remote_rank, 0, MPI_COMM_WORLD,
-					 &status);
-			}
+			timer = timer_now();
+
+			for (i = 0; i < iterations; ++i)
+				pingpong_initiate(send_buffer, recv_buffer,
+						  length, remote_rank,
+						  MPI_COMM_WORLD, NULL);
 
 			/* stop timer: */
-			timer = (MPI_Wtime() - timer);
+			timer = timer_elapsed(timer);
 
-			printf("%1.2lf\n",
-			       timer / (2.0 * iterations) * 1000000);
-			fflush(stdout);
+			/* achieved period and delay behind the deadline */
+			if (!run_infinitely) {
+				periods[round] = round
+				    ? (start - last_start) * 1e-3 : delay;
+				lateness[round] = (start - deadline) * 1e-3;
+			}
+
+			if (pairing.num_pairs > 1)
+				ringlog_put(&log, pairing.pair_id,
+					    timer / (2.0 * iterations) * 1e6,
+					    round ? (start - last_start) * 1e-3
+						  : delay,
+					    (start - deadline) * 1e-3);
+			else
+				ringlog_put(&log,
+					    timer / (2.0 * iterations) * 1e6,
+					    round ? (start - last_start) * 1e-3
+						  : delay,
+					    (start - deadline) * 1e-3, 0);
+			last_start = start;
 
-			// delay next ping
-			useconds_t timer_usec = (useconds_t)(timer * 1e6);
-			useconds_t sleep_time;
-			if (delay < timer_usec) {
-				sleep_time = 0;
+			/* batches are printed in the slack before a deadline */
+			if (now_ns() - last_flush >= FLUSHINTERVAL) {
+				ringlog_flush(&log, true);
+				last_flush = now_ns();
 			} else {
-				sleep_time = delay - timer_usec;
+				ringlog_flush(&log, false);
 			}
 
-#ifdef _SHOW_PERIOD_
-			double cur_time_stamp = MPI_Wtime();
-			printf("CUR PERIOD: %f\n", cur_time_stamp - last_sleep);
-			last_sleep = cur_time_stamp;
-#endif
-			usleep(sleep_time);
-		}
-	} else {
-		for (i = 0; i < WARMUPITER; ++i) {
-			MPI_Recv(recv_buffer, length, MPI_CHAR, remote_rank, 0,
-				 MPI_COMM_WORLD, &status);
-			MPI_Send(send_buffer, length, MPI_CHAR, remote_rank, 0,
-				 MPI_COMM_WORLD);
+			/* skip the deadlines that passed during an overrun */
+			deadline += period;
+			if (deadline <= now_ns()) {
+				int64_t behind = now_ns() - deadline;
+
+				missed += behind / period + 1;
+				deadline += (behind / period + 1) * period;
+			}
 		}
+		ringlog_finish(&log);
+		if (log_cost)
+			ringlog_report(&log, stdout);
+	} else if (pairing.partner != -1) {
+		for (i = 0; i < WARMUPITER; ++i)
+			pingpong_respond(send_buffer, recv_buffer, length,
+					 remote_rank, MPI_COMM_WORLD);
 		MPI_Barrier(MPI_COMM_WORLD);
 
 		for (round = 0; run_infinitely || (round < numrounds);
 		     ++round) {
-			for (i = 0; i < iterations; ++i) {
-				MPI_Recv(recv_buffer, length, MPI_CHAR,
-					 remote_rank, 0, MPI_COMM_WORLD,
-					 &status);
-				MPI_Send(send_buffer, length, MPI_CHAR,
-					 remote_rank, 0, MPI_COMM_WORLD);
-			}
+			for (i = 0; i < iterations; ++i)
+				pingpong_respond(send_buffer, recv_buffer,
+						 length, remote_rank,
+						 MPI_COMM_WORLD);
 		}
+	} else {
+		/* unpaired ranks only take part in the synchronization */
+		MPI_Barrier(MPI_COMM_WORLD);
+	}
+
+	/* period errors of all pairs (the first round has no period) */
+	if (!run_infinitely && (numrounds > 1)) {
+		MPI_Reduce(&missed, &total_missed, 1, MPI_UINT64_T, MPI_SUM, 0,
+			   MPI_COMM_WORLD);
+		report_schedule(&pairing, "Achieved period (usec)",
+				periods + 1, numrounds - 1);
+		report_schedule(&pairing, "Lateness behind deadline (usec)",
+				lateness, numrounds);
+		if (my_rank == 0)
+			printf("#Missed deadlines: %" PRIu64 "\n",
+			       total_missed);
 	}
 
+	free(periods);
+	free(lateness);
+	pairing_free(&pairing);
+	buffer_free(&send_mem);
 	MPI_Finalize();
 
 	return 0;
@@ -0,0 +1,316 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <report.h>
+
+static const char *report_names[REPORT_NUM_FORMATS] = {
+	"text", "csv", "json"
+};
+
+/* translate an output format given on the command line */
+int
+report_parse(const char *name,
+	     report_format_t *format) {
+	int i;
+
+	for (i=0; i<REPORT_NUM_FORMATS; ++i) {
+		if (strcmp(name, report_names[i]) == 0) {
+			*format = (report_format_t)i;
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+const char *
+report_format_name(report_format_t format) {
+	return (format < REPORT_NUM_FORMATS) ? report_names[format] : "unknown";
+}
+
+/*
+ * Gather the host names on rank 0 of 'comm' and determine the MPI library;
+ * the caller fills in the benchmark-specific fields.
+ */
+void
+report_info_collect(MPI_Comm comm,
+		    report_info_t *info) {
+	char name[MPI_MAX_PROCESSOR_NAME];
+	char *names = NULL;
+	int32_t i, j, my_rank, num_ranks;
+	int len;
+	size_t pos = 0;
+
+	MPI_Comm_rank(comm, &my_rank);
+	MPI_Comm_size(comm, &num_ranks);
+
+	memset(info, 0, sizeof(report_info_t));
+	info->num_ranks = num_ranks;
+
+	/* the first line of the version string is sufficient */
+	MPI_Get_library_version(info->mpi_version, &len);
+	info->mpi_version[strcspn(info->mpi_version, "\r\n")] = '\0';
+
+	memset(name, 0, sizeof(name));
+	MPI_Get_processor_name(name, &len);
+	if (my_rank == 0)
+		names = (char *)malloc((size_t)num_ranks*
+				       MPI_MAX_PROCESSOR_NAME);
+	MPI_Gather(name, MPI_MAX_PROCESSOR_NAME, MPI_CHAR, names,
+		   MPI_MAX_PROCESSOR_NAME, MPI_CHAR, 0, comm);
+	if (my_rank != 0)
+		return;
+
+	info->hosts = (char *)calloc((size_t)num_ranks,
+				     MPI_MAX_PROCESSOR_NAME+1);
+	for (i=0; i<num_ranks; ++i) {
+		const char *host = &names[i*MPI_MAX_PROCESSOR_NAME];
+
+		for (j=0; j<i; ++j) {
+			if (strcmp(host, &names[j*MPI_MAX_PROCESSOR_NAME]) == 0)
+				break;
+		}
+		if (j < i)
+			continue;
+
+		if (pos)
+			info->hosts[pos++] = ';';
+		strcpy(&info->hosts[pos], host);
+		pos += strlen(host);
+	}
+	free(names);
+}
+
+void
+report_info_free(report_info_t *info) {
+	free(info->hosts);
+	info->hosts = NULL;
+}
+
+/* quoted string with CSV (doubled quotes) or JSON escaping */
+static void
+print_string(FILE *output,
+	     report_format_t format,
+	     const char *str) {
+	fputc('"', output);
+	for (; str && *str; ++str) {
+		if (*str == '"')
+			fputs((format == REPORT_CSV) ? "\"\"" : "\\\"", output);
+		else if ((format == REPORT_JSON) && (*str == '\\'))
+			fputs("\\\\", output);
+		else if ((unsigned char)*str < 0x20)
+			fputc(' ', output);
+		else
+			fputc(*str, output);
+	}
+	fputc('"', output);
+}
+
+/* JSON has no representation of inf/nan */
+static void
+print_number(FILE *output,
+	     report_format_t format,
+	     double val) {
+	if (isfinite(val))
+		fprintf(output, "%.17g", val);
+	else if (format == REPORT_JSON)
+		fprintf(output, "null");
+}
+
+static void
+print_csv_header(report_t *report) {
+	FILE *out = report->output;
+	double percentiles[STAT_EVAL_MAX_PERCENTILES];
+	uint32_t i, num;
+
+	/* the percentile columns follow the configured percentiles */
+	num = stat_eval_get_percentiles(percentiles);
+
+	fprintf(out, "benchmark,variant,bytes,rounds,iterations,ranks,pairs,"
+		"hosts,mpi_library,samples,minimum,maximum,mean,variance,"
+		"std_deviation,lower_whisker,lower_quartile,median,"
+		"upper_quartile,upper_whisker,lower_outliers,upper_outliers,"
+		"steady_maximum");
+	for (i=0; i<num; ++i)
+		fprintf(out, ",p%g", percentiles[i]);
+	fprintf(out, "\n");
+}
+
+void
+report_begin(report_t *report,
+	     report_format_t format,
+	     FILE *output) {
+	report->format = format;
+	report->output = output;
+	report->records = 0;
+
+	if (format == REPORT_CSV)
+		print_csv_header(report);
+	else if (format == REPORT_JSON)
+		fprintf(output, "[");
+}
+
+static void
+print_csv_record(report_t *report,
+		 const report_info_t *info,
+		 const stat_eval_t *stat_eval,
+		 uint64_t count) {
+	FILE *out = report->output;
+	const box_plot_vals_t *bp = &stat_eval->box_plot;
+	const double vals[] = {
+		stat_eval->minimum, stat_eval->maximum, stat_eval->average,
+		stat_eval->variance, stat_eval->std_devation,
+		bp->lower_whisker, bp->lower_quartil, bp->median,
+		bp->upper_quartil, bp->upper_whisker
+	};
+	uint32_t i;
+
+	print_string(out, REPORT_CSV, info->benchmark);
+	fputc(',', out);
+	print_string(out, REPORT_CSV, info->variant);
+	fprintf(out, ",%" PRIu64 ",%" PRId64 ",%u,%d,%d,", info->length,
+		info->rounds, info->iterations, info->num_ranks,
+		info->num_pairs);
+	print_string(out, REPORT_CSV, info->hosts);
+	fputc(',', out);
+	print_string(out, REPORT_CSV, info->mpi_version);
+	fprintf(out, ",%" PRIu64, count);
+	for (i=0; i<sizeof(vals)/sizeof(vals[0]); ++i) {
+		fputc(',', out);
+		print_number(out, REPORT_CSV, vals[i]);
+	}
+	fprintf(out, ",%" PRIu64 ",%" PRIu64 ",", bp->lower_outlier,
+		bp->upper_outlier);
+	print_number(out, REPORT_CSV, stat_eval->tail.steady_maximum);
+	for (i=0; i<stat_eval->tail.num_percentiles; ++i) {
+		fputc(',', out);
+		print_number(out, REPORT_CSV,
+			     stat_eval->tail.percentile_vals[i]);
+	}
+	fprintf(out, "\n");
+}
+
+static void
+print_json_field(FILE *out,
+		 const char *name,
+		 double val) {
+	fprintf(out, ",\n    \"%s\": ", name);
+	print_number(out, REPORT_JSON, val);
+}
+
+static void
+print_json_record(report_t *report,
+		  const report_info_t *info,
+		  const stat_eval_t *stat_eval,
+		  uint64_t count) {
+	FILE *out = report->output;
+	const box_plot_vals_t *bp = &stat_eval->box_plot;
+	const tail_vals_t *tail = &stat_eval->tail;
+	uint32_t i;
+
+	fprintf(out, "%s\n  {\n    \"benchmark\": ",
+		report->records ? "," : "");
+	print_string(out, REPORT_JSON, info->benchmark);
+	fprintf(out, ",\n    \"variant\": ");
+	print_string(out, REPORT_JSON, info->variant);
+	fprintf(out, ",\n    \"bytes\": %" PRIu64, info->length);
+	fprintf(out, ",\n    \"rounds\": %" PRId64, info->rounds);
+	fprintf(out, ",\n    \"iterations\": %u", info->iterations);
+	fprintf(out, ",\n    \"ranks\": %d", info->num_ranks);
+	fprintf(out, ",\n    \"pairs\": %d", info->num_pairs);
+	fprintf(out, ",\n    \"hosts\": ");
+	print_string(out, REPORT_JSON, info->hosts);
+	fprintf(out, ",\n    \"mpi_library\": ");
+	print_string(out, REPORT_JSON, info->mpi_version);
+	fprintf(out, ",\n    \"samples\": %" PRIu64, count);
+	print_json_field(out, "minimum", stat_eval->minimum);
+	print_json_field(out, "maximum", stat_eval->maximum);
+	print_json_field(out, "mean", stat_eval->average);
+	print_json_field(out, "variance", stat_eval->variance);
+	print_json_field(out, "std_deviation", stat_eval->std_devation);
+	print_json_field(out, "lower_whisker", bp->lower_whisker);
+	print_json_field(out, "lower_quartile", bp->lower_quartil);
+	print_json_field(out, "median", bp->median);
+	print_json_field(out, "upper_quartile", bp->upper_quartil);
+	print_json_field(out, "upper_whisker", bp->upper_whisker);
+	fprintf(out, ",\n    \"lower_outliers\": %" PRIu64, bp->lower_outlier);
+	fprintf(out, ",\n    \"upper_outliers\": %" PRIu64, bp->upper_outlier);
+	print_json_field(out, "steady_maximum", tail->steady_maximum);
+
+	fprintf(out, ",\n    \"percentiles\": {");
+	for (i=0; i<tail->num_percentiles; ++i) {
+		fprintf(out, "%s\"%g\": ", i ? ", " : "",
+			tail->percentiles[i]);
+		print_number(out, REPORT_JSON, tail->percentile_vals[i]);
+	}
+
+	/* bucket i counts samples in [2^(i+MIN_EXP), 2^(i+MIN_EXP+1)) us */
+	fprintf(out, "},\n    \"histogram_min_exp\": %d",
+		STAT_EVAL_HIST_MIN_EXP);
+	fprintf(out, ",\n    \"histogram\": [");
+	for (i=0; i<STAT_EVAL_HIST_BUCKETS; ++i)
+		fprintf(out, "%s%" PRIu64, i ? ", " : "", tail->histogram[i]);
+	fprintf(out, "]\n  }");
+}
+
+/* write one record; the text format falls back to print_statistics() */
+void
+report_record(report_t *report,
+	      const report_info_t *info,
+	      const stat_eval_t *stat_eval,
+	      uint64_t count) {
+	switch (report->format) {
+		case REPORT_CSV:
+			print_csv_record(report, info, stat_eval, count);
+			break;
+		case REPORT_JSON:
+			print_json_record(report, info, stat_eval, count);
+			break;
+		default:
+			print_statistics(stat_eval, count, report->output);
+			break;
+	}
+	report->records++;
+	fflush(report->output);
+}
+
+void
+report_end(report_t *report) {
+	if (report->format == REPORT_JSON)
+		fprintf(report->output, "\n]\n");
+	fflush(report->output);
+}
+
+/* append one block of raw samples to 'raw'; returns -1 on I/O errors */
+int
+report_dump_samples(FILE *raw,
+		    const report_info_t *info,
+		    const double *samples,
+		    uint64_t num_samples,
+		    uint64_t num_series) {
+	report_raw_header_t header;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, REPORT_RAW_MAGIC, sizeof(REPORT_RAW_MAGIC));
+	header.version = REPORT_RAW_VERSION;
+	header.header_size = sizeof(header);
+	header.num_samples = num_samples;
+	header.num_series = num_series;
+	header.length = info->length;
+	header.rounds = info->rounds;
+	header.iterations = info->iterations;
+	header.num_ranks = info->num_ranks;
+	if (info->benchmark)
+		strncpy(header.benchmark, info->benchmark,
+			REPORT_RAW_NAME_LEN-1);
+	if (info->variant)
+		strncpy(header.variant, info->variant, REPORT_RAW_NAME_LEN-1);
+
+	if (fwrite(&header, sizeof(header), 1, raw) != 1)
+		return -1;
+	if (num_samples &&
+	    (fwrite(samples, sizeof(double), num_samples, raw) != num_samples))
+		return -1;
+
+	return 0;
+}
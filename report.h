@@ -0,0 +1,102 @@
+#ifndef _REPORT_H
+#define _REPORT_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <mpi.h>
+
+#include <stat_eval.h>
+
+/*
+ * Machine-readable results: one record per measured configuration, written
+ * as CSV (one header line, one row per record) or as a JSON array. The
+ * human-readable text format remains print_statistics().
+ */
+typedef enum _report_format_t {
+	REPORT_TEXT = 0,
+	REPORT_CSV,
+	REPORT_JSON,
+	REPORT_NUM_FORMATS
+} report_format_t;
+
+/* configuration metadata of a record */
+typedef struct _report_info_t {
+	const char *benchmark;
+	const char *variant;	/* e.g., collective or cache mode */
+	uint64_t length;	/* message length in bytes */
+	int64_t rounds;		/* -1 for infinite runs */
+	uint32_t iterations;
+	int32_t num_ranks;
+	int32_t num_pairs;	/* 0 if the benchmark is not pair-based */
+	char *hosts;		/* distinct host names, ';'-separated */
+	char mpi_version[MPI_MAX_LIBRARY_VERSION_STRING];
+} report_info_t;
+
+typedef struct _report_t {
+	report_format_t format;
+	FILE *output;
+	uint64_t records;
+} report_t;
+
+/*
+ * Raw sample dump: a sequence of blocks, each a fixed-size header followed
+ * by 'num_samples' doubles (usec). The samples of 'num_series' series (e.g.,
+ * pairs) are stored one series after the other in chronological order, so
+ * a block can be memory-mapped and used as a [num_series][n] array.
+ */
+#define REPORT_RAW_MAGIC	"MPIBRAW"
+#define REPORT_RAW_VERSION	(1)
+#define REPORT_RAW_NAME_LEN	(32)
+
+typedef struct _report_raw_header_t {
+	char magic[8];
+	uint32_t version;
+	uint32_t header_size;	/* offset of the samples within the block */
+	uint64_t num_samples;
+	uint64_t num_series;
+	uint64_t length;
+	int64_t rounds;
+	uint32_t iterations;
+	int32_t num_ranks;
+	char benchmark[REPORT_RAW_NAME_LEN];
+	char variant[REPORT_RAW_NAME_LEN];
+	uint8_t reserved[8];
+} report_raw_header_t;
+
+int
+report_parse(const char *name,
+	     report_format_t *format);
+
+const char *
+report_format_name(report_format_t format);
+
+void
+report_info_collect(MPI_Comm comm,
+		    report_info_t *info);
+
+void
+report_info_free(report_info_t *info);
+
+void
+report_begin(report_t *report,
+	     report_format_t format,
+	     FILE *output);
+
+void
+report_record(report_t *report,
+	      const report_info_t *info,
+	      const stat_eval_t *stat_eval,
+	      uint64_t count);
+
+void
+report_end(report_t *report);
+
+int
+report_dump_samples(FILE *raw,
+		    const report_info_t *info,
+		    const double *samples,
+		    uint64_t num_samples,
+		    uint64_t num_series);
+
+#endif /* _REPORT_H */
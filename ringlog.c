@@ -0,0 +1,213 @@
+#include <inttypes.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <ringlog.h>
+
+/* the writer thread polls an empty ring at this interval */
+#define RINGLOG_POLL_NS	(100000)
+
+static const char *ringlog_names[RINGLOG_NUM_MODES] = {
+	"direct", "batch", "thread"
+};
+
+/* translate a logging mode given on the command line */
+int
+ringlog_parse(const char *name,
+	      ringlog_mode_t *mode) {
+	int i;
+
+	for (i=0; i<RINGLOG_NUM_MODES; ++i) {
+		if (strcmp(name, ringlog_names[i]) == 0) {
+			*mode = (ringlog_mode_t)i;
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+const char *
+ringlog_name(ringlog_mode_t mode) {
+	return (mode < RINGLOG_NUM_MODES) ? ringlog_names[mode] : "unknown";
+}
+
+static inline double
+now_ns(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec*1e9 + ts.tv_nsec;
+}
+
+static inline void
+print_rec(ringlog_t *log,
+	  const ringlog_rec_t *rec) {
+	/* surplus arguments are ignored by fprintf() */
+	fprintf(log->output, log->format, rec->vals[0], rec->vals[1],
+		rec->vals[2], rec->vals[3]);
+}
+
+/* print all records up to the current head */
+static void
+drain(ringlog_t *log) {
+	uint64_t head = atomic_load_explicit(&log->head, memory_order_acquire);
+	uint64_t tail = atomic_load_explicit(&log->tail, memory_order_relaxed);
+	double start = 0;
+
+	if (tail == head)
+		return;
+
+	if (log->measure)
+		start = now_ns();
+	for (; tail != head; ++tail)
+		print_rec(log, &log->recs[tail & (log->capacity-1)]);
+	fflush(log->output);
+	if (log->measure)
+		log->drain_time += now_ns()-start;
+
+	atomic_store_explicit(&log->tail, tail, memory_order_release);
+}
+
+static void *
+writer_thread(void *arg) {
+	ringlog_t *log = (ringlog_t *)arg;
+	struct timespec poll = { 0, RINGLOG_POLL_NS };
+
+	while (!atomic_load_explicit(&log->done, memory_order_acquire)) {
+		drain(log);
+		nanosleep(&poll, NULL);
+	}
+	drain(log);
+
+	return NULL;
+}
+
+/*
+ * 'capacity' is rounded up to a power of two; 'format' receives the
+ * RINGLOG_MAX_VALS values of a record as doubles
+ */
+int
+ringlog_init(ringlog_t *log,
+	     ringlog_mode_t mode,
+	     uint64_t capacity,
+	     FILE *output,
+	     const char *format,
+	     bool measure) {
+	memset(log, 0, sizeof(ringlog_t));
+	log->mode = mode;
+	log->output = output;
+	log->format = format;
+	log->measure = measure;
+
+	for (log->capacity=2; log->capacity<capacity; log->capacity*=2)
+		;
+	log->recs = (ringlog_rec_t *)calloc(log->capacity,
+					    sizeof(ringlog_rec_t));
+	if (log->recs == NULL)
+		return -1;
+	atomic_init(&log->head, 0);
+	atomic_init(&log->tail, 0);
+	atomic_init(&log->done, false);
+
+	if ((mode == RINGLOG_THREAD) &&
+	    pthread_create(&log->writer, NULL, writer_thread, log)) {
+		free(log->recs);
+		log->recs = NULL;
+		return -1;
+	}
+
+	return 0;
+}
+
+/* record one result; only 'direct' prints here */
+void
+ringlog_put(ringlog_t *log,
+	    double v0,
+	    double v1,
+	    double v2,
+	    double v3) {
+	uint64_t head = atomic_load_explicit(&log->head, memory_order_relaxed);
+	ringlog_rec_t *rec = &log->recs[head & (log->capacity-1)];
+	double start = 0;
+
+	if (log->measure)
+		start = now_ns();
+
+	/* a full ring has to wait for the drain */
+	if (head-atomic_load_explicit(&log->tail, memory_order_acquire) ==
+	    log->capacity) {
+		log->stalls++;
+		if (log->mode == RINGLOG_THREAD) {
+			while (head-atomic_load_explicit(&log->tail,
+			       memory_order_acquire) == log->capacity)
+				sched_yield();
+		} else {
+			drain(log);
+		}
+	}
+
+	rec->vals[0] = v0;
+	rec->vals[1] = v1;
+	rec->vals[2] = v2;
+	rec->vals[3] = v3;
+	log->records++;
+	atomic_store_explicit(&log->head, head+1, memory_order_release);
+
+	if (log->mode == RINGLOG_DIRECT)
+		drain(log);
+
+	if (log->measure)
+		log->put_time += now_ns()-start;
+}
+
+/* call outside of the timed region: drains a half-full ring in batch mode */
+void
+ringlog_flush(ringlog_t *log,
+	      bool force) {
+	uint64_t fill;
+
+	if (log->mode != RINGLOG_BATCH)
+		return;
+
+	fill = atomic_load_explicit(&log->head, memory_order_relaxed) -
+	    atomic_load_explicit(&log->tail, memory_order_relaxed);
+	if (force || (fill >= log->capacity/2))
+		drain(log);
+}
+
+/* print the remaining records and stop the writer thread */
+void
+ringlog_finish(ringlog_t *log) {
+	if (log->recs == NULL)
+		return;
+
+	if (log->mode == RINGLOG_THREAD) {
+		atomic_store_explicit(&log->done, true, memory_order_release);
+		pthread_join(log->writer, NULL);
+	} else {
+		drain(log);
+	}
+	free(log->recs);
+	log->recs = NULL;
+}
+
+/* the cost of logging, as accounted with 'measure' */
+void
+ringlog_report(const ringlog_t *log,
+	       FILE *output) {
+	uint64_t n = log->records ? log->records : 1;
+
+	fprintf(output, "#Logging   : %s, %" PRIu64 " records, %" PRIu64
+		" stalls\n", ringlog_name(log->mode), log->records,
+		log->stalls);
+	fprintf(output, "#Log put   : %10.1f ns/record (in the loop)\n",
+		log->put_time/n);
+	fprintf(output, "#Log drain : %10.1f ns/record (%s)\n",
+		log->drain_time/n,
+		(log->mode == RINGLOG_THREAD) ? "writer thread" :
+		(log->mode == RINGLOG_BATCH) ? "between rounds" :
+		"in the loop");
+}
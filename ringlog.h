@@ -0,0 +1,84 @@
+#ifndef _RINGLOG_H
+#define _RINGLOG_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Per-round results are put into a preallocated ring buffer instead of being
+ * printed within the measurement loop. The ring is drained
+ *   - direct: not at all; every record is printed and flushed immediately
+ *   - batch:  by the benchmark between rounds (ringlog_flush()) once it is
+ *             half full, i.e., outside of the timed region
+ *   - thread: by a writer thread that sleeps while the ring is empty
+ * A record consists of up to RINGLOG_MAX_VALS doubles that are passed to
+ * the printf() format of the log.
+ */
+#define RINGLOG_MAX_VALS		(4)
+#define RINGLOG_DEFAULT_CAPACITY	(1 << 16)
+
+typedef enum _ringlog_mode_t {
+	RINGLOG_DIRECT = 0,
+	RINGLOG_BATCH,
+	RINGLOG_THREAD,
+	RINGLOG_NUM_MODES
+} ringlog_mode_t;
+
+typedef struct _ringlog_rec_t {
+	double vals[RINGLOG_MAX_VALS];
+} ringlog_rec_t;
+
+typedef struct _ringlog_t {
+	ringlog_mode_t mode;
+	FILE *output;
+	const char *format;
+	bool measure;		/* account the time spent for logging */
+	ringlog_rec_t *recs;
+	uint64_t capacity;	/* power of two */
+	_Atomic uint64_t head;	/* next record to put (benchmark) */
+	_Atomic uint64_t tail;	/* next record to print (drain) */
+	_Atomic bool done;
+	pthread_t writer;
+	uint64_t records;
+	uint64_t stalls;	/* puts that had to wait for a full ring */
+	double put_time;	/* ns spent in ringlog_put() */
+	double drain_time;	/* ns spent printing */
+} ringlog_t;
+
+int
+ringlog_parse(const char *name,
+	      ringlog_mode_t *mode);
+
+const char *
+ringlog_name(ringlog_mode_t mode);
+
+int
+ringlog_init(ringlog_t *log,
+	     ringlog_mode_t mode,
+	     uint64_t capacity,
+	     FILE *output,
+	     const char *format,
+	     bool measure);
+
+void
+ringlog_put(ringlog_t *log,
+	    double v0,
+	    double v1,
+	    double v2,
+	    double v3);
+
+void
+ringlog_flush(ringlog_t *log,
+	      bool force);
+
+void
+ringlog_finish(ringlog_t *log);
+
+void
+ringlog_report(const ringlog_t *log,
+	       FILE *output);
+
+#endif /* _RINGLOG_H */
@@ -0,0 +1,181 @@
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <mpi.h>
+
+#include <setup.h>
+
+void
+setup_init(setup_t *setup,
+	   int32_t my_rank) {
+	memset(setup, 0, sizeof(setup_t));
+	setup->my_rank = my_rank;
+	setup->buffer_kind = BUFFER_MALLOC;
+	setup->alignment = BUFFER_DEFAULT_ALIGN;
+	setup->timer = TIMER_MPI;
+	setup->output = stdout;
+}
+
+/*
+ * handle one of the shared options; returns -1 if 'option' is none of them
+ * and aborts on invalid values
+ */
+int
+setup_parse(setup_t *setup,
+	    int option,
+	    char *arg) {
+	switch (option) {
+		case 'B':
+			if (buffer_parse(arg, &setup->buffer_kind))
+				setup_abort(setup->my_rank,
+					    "unknown buffer kind '%s'", arg);
+			break;
+		case 'A':
+			setup->alignment = atoi(arg);
+			break;
+		case 'O':
+			setup->offset = atoi(arg);
+			break;
+		case 't':
+			if (timer_parse(arg, &setup->timer))
+				setup_abort(setup->my_rank,
+					    "unknown timer '%s'", arg);
+			break;
+		case 'X':
+			setup->timer_subtract = true;
+			break;
+		case 'f':
+			setup->filename = arg;
+			break;
+		default:
+			return -1;
+	}
+
+	return 0;
+}
+
+/* the usage of the shared options, without a line break */
+void
+setup_usage(FILE *output,
+	    bool filename) {
+	if (filename)
+		fprintf(output, "[-f filename] ");
+	fprintf(output, "[-B malloc|hugetlb|thp|mpi (def: malloc)] "
+		"[-A alignment (def: %d)] "
+		"[-O offset (def: 0)] "
+		"[-t mpi|clock|tsc (def: mpi)] "
+		"[-X (subtract timer overhead)]", BUFFER_DEFAULT_ALIGN);
+}
+
+/* select and calibrate the time source */
+void
+setup_timer(setup_t *setup) {
+	if (timer_select(setup->timer))
+		setup_fail("timer '%s' is not available",
+			   timer_name(setup->timer));
+	timer_calibrate(&setup->timer_calib);
+	if (setup->timer_subtract)
+		timer_subtract_overhead(&setup->timer_calib);
+}
+
+void
+setup_buffer(const setup_t *setup,
+	     buffer_t *buffer,
+	     size_t length) {
+	if (buffer_alloc(buffer, length, setup->alignment, setup->offset,
+			 setup->buffer_kind))
+		setup_fail("cannot allocate %s buffer (%zu bytes, alignment "
+			   "%u)", buffer_name(setup->buffer_kind), length,
+			   setup->alignment);
+}
+
+/* rank 0 writes to the file given by -f, if any */
+FILE *
+setup_output(setup_t *setup) {
+	setup->output = stdout;
+	if ((setup->my_rank == 0) && setup->filename) {
+		setup->output = fopen(setup->filename, "w+");
+		if (setup->output == NULL)
+			setup_fail("cannot open '%s'", setup->filename);
+	}
+
+	return setup->output;
+}
+
+void
+setup_close(setup_t *setup) {
+	if ((setup->my_rank == 0) && setup->filename && setup->output)
+		fclose(setup->output);
+	setup->output = NULL;
+}
+
+/*
+ * the banner lines of the shared options (rank 0); 'comment' prefixes them
+ * with '#' for tools whose banner is part of the data
+ */
+void
+setup_print(const setup_t *setup,
+	    bool comment) {
+	if (comment) {
+		printf("#buffer: %s (align %u, offset %u)\n",
+		       buffer_name(setup->buffer_kind), setup->alignment,
+		       setup->offset);
+		timer_print_calibration(stdout, "#timer: ", "#       ");
+		return;
+	}
+
+	printf("Buffer     : %10s (align %u, offset %u)\n",
+	       buffer_name(setup->buffer_kind), setup->alignment,
+	       setup->offset);
+	timer_print_calibration(stdout, "Timer      : ", "             ");
+	if (setup->filename)
+		printf("Filename   : %s\n", setup->filename);
+	else
+		printf("Filename   :     stdout\n");
+}
+
+/* report an error that all ranks detect (rank 0) and exit */
+void
+setup_abort(int32_t my_rank,
+	    const char *format,
+	    ...) {
+	char message[256];
+	va_list args;
+
+	if (my_rank == 0) {
+		va_start(args, format);
+		vsnprintf(message, sizeof(message), format, args);
+		va_end(args);
+		fprintf(stderr, "ERROR: %s. Abort!\n", message);
+	}
+	exit(-1);
+}
+
+/*
+ * report an error of the calling rank alone and terminate the job; the
+ * other ranks would otherwise wait for it forever
+ */
+void
+setup_fail(const char *format,
+	   ...) {
+	char message[256];
+	va_list args;
+	int initialized, finalized, rank;
+
+	va_start(args, format);
+	vsnprintf(message, sizeof(message), format, args);
+	va_end(args);
+
+	MPI_Initialized(&initialized);
+	MPI_Finalized(&finalized);
+	if (!initialized || finalized) {
+		fprintf(stderr, "ERROR: %s. Abort!\n", message);
+		exit(-1);
+	}
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	fprintf(stderr, "ERROR: rank %d: %s. Abort!\n", rank, message);
+	MPI_Abort(MPI_COMM_WORLD, -1);
+	exit(-1);
+}
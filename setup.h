@@ -0,0 +1,77 @@
+#ifndef _SETUP_H
+#define _SETUP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <buffer.h>
+#include <timer.h>
+
+/*
+ * Command-line setup shared by the tools: the message buffers (-B/-A/-O),
+ * the time source (-t/-X) and the output file (-f). A tool appends
+ * SETUP_OPTIONS (and "f:" if it writes an output file) to its getopt()
+ * string, hands the options it does not know to setup_parse(), lists them
+ * with setup_usage() and shows them in its banner with setup_print().
+ * Errors that every rank detects (e.g., invalid arguments) end with
+ * setup_abort(): rank 0 reports, all ranks exit. Errors of a single rank
+ * (e.g., a failed allocation) end with setup_fail(): the failing rank
+ * reports and aborts the job.
+ */
+#define SETUP_OPTIONS	"B:A:O:t:X"
+
+typedef struct _setup_t {
+	int32_t my_rank;
+	buffer_kind_t buffer_kind;
+	uint32_t alignment;
+	uint32_t offset;
+	timer_backend_t timer;
+	bool timer_subtract;
+	timer_calib_t timer_calib;
+	char *filename;		/* NULL: stdout */
+	FILE *output;		/* valid on rank 0 after setup_output() */
+} setup_t;
+
+void
+setup_init(setup_t *setup,
+	   int32_t my_rank);
+
+int
+setup_parse(setup_t *setup,
+	    int option,
+	    char *arg);
+
+void
+setup_usage(FILE *output,
+	    bool filename);
+
+void
+setup_timer(setup_t *setup);
+
+void
+setup_buffer(const setup_t *setup,
+	     buffer_t *buffer,
+	     size_t length);
+
+FILE *
+setup_output(setup_t *setup);
+
+void
+setup_close(setup_t *setup);
+
+void
+setup_print(const setup_t *setup,
+	    bool comment);
+
+void
+setup_abort(int32_t my_rank,
+	    const char *format,
+	    ...) __attribute__((noreturn, format(printf, 2, 3)));
+
+void
+setup_fail(const char *format,
+	   ...) __attribute__((noreturn, format(printf, 1, 2)));
+
+#endif /* _SETUP_H */
@@ -0,0 +1,436 @@
+/*
+ * Copyright 2017, Simon Pickartz Institute for Automation
+ *                                of Complex Power Systems,
+ *                                RWTH Aachen University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Compare two result sets of the benchmarks, e.g., before and after an
+ * upgrade. Both files are either raw sample dumps (-D) or CSV reports
+ * (-F csv). Records are matched by benchmark, variant and message length.
+ * With raw samples, the medians are compared with a Mann-Whitney U test and
+ * a bootstrap confidence interval of the relative median difference; CSV
+ * reports only allow comparing the medians. The exit code is 1 if any
+ * record is slower than the threshold (and the slowdown is significant).
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <report.h>
+#include <stat_eval.h>
+
+#define DEFAULTTHRESHOLD (5.0)
+#define DEFAULTALPHA (0.05)
+#define DEFAULTRESAMPLES (1000)
+#define DEFAULTCONFIDENCE (95.0)
+#define DEFAULTSEED (42)
+#define MAXFIELDS (64)
+
+/* one measured configuration of a result file */
+typedef struct _cmp_record_t {
+	char benchmark[REPORT_RAW_NAME_LEN];
+	char variant[REPORT_RAW_NAME_LEN];
+	uint64_t length;
+	uint64_t count;		/* samples the record is based on */
+	double median;
+	double *samples;	/* NULL for summaries */
+	bool matched;
+} cmp_record_t;
+
+typedef struct _cmp_set_t {
+	const char *name;
+	cmp_record_t *records;
+	uint32_t num_records;
+} cmp_set_t;
+
+static cmp_record_t *add_record(cmp_set_t *set) {
+	cmp_record_t *rec;
+
+	set->records = (cmp_record_t *)realloc(
+	    set->records, sizeof(cmp_record_t) * (set->num_records + 1));
+	if (set->records == NULL) {
+		fprintf(stderr, "ERROR: out of memory. Abort!\n");
+		exit(-1);
+	}
+	rec = &set->records[set->num_records++];
+	memset(rec, 0, sizeof(cmp_record_t));
+
+	return rec;
+}
+
+/* all blocks of a raw sample dump; the series of a block are pooled */
+static void load_raw(FILE *file, cmp_set_t *set) {
+	report_raw_header_t header;
+	cmp_record_t *rec;
+	double *scratch;
+
+	while (fread(&header, sizeof(header), 1, file) == 1) {
+		if (memcmp(header.magic, REPORT_RAW_MAGIC,
+			   sizeof(REPORT_RAW_MAGIC)) ||
+		    (header.version != REPORT_RAW_VERSION) ||
+		    (header.header_size < sizeof(header))) {
+			fprintf(stderr, "ERROR: '%s' is corrupt. Abort!\n",
+				set->name);
+			exit(-1);
+		}
+		fseek(file, header.header_size - sizeof(header), SEEK_CUR);
+
+		rec = add_record(set);
+		memcpy(rec->benchmark, header.benchmark, REPORT_RAW_NAME_LEN);
+		memcpy(rec->variant, header.variant, REPORT_RAW_NAME_LEN);
+		rec->benchmark[REPORT_RAW_NAME_LEN - 1] = '\0';
+		rec->variant[REPORT_RAW_NAME_LEN - 1] = '\0';
+		rec->length = header.length;
+		rec->count = header.num_samples;
+		rec->samples = (double *)malloc(sizeof(double) *
+						(rec->count ? rec->count : 1));
+		if ((rec->samples == NULL) ||
+		    (fread(rec->samples, sizeof(double), rec->count, file) !=
+		     rec->count)) {
+			fprintf(stderr, "ERROR: cannot read the samples of "
+				"'%s'. Abort!\n", set->name);
+			exit(-1);
+		}
+
+		scratch = (double *)malloc(sizeof(double) *
+					   (rec->count ? rec->count : 1));
+		memcpy(scratch, rec->samples, sizeof(double) * rec->count);
+		rec->median = stat_eval_median(scratch, rec->count);
+		free(scratch);
+	}
+}
+
+/* split a CSV line in place; quoted fields may contain "" and commas */
+static int split_csv(char *line, char **fields, int max_fields) {
+	int num = 0;
+	char *src = line, *dst;
+
+	while (num < max_fields) {
+		fields[num++] = dst = src;
+		if (*src == '"') {
+			for (++src; *src; ++src) {
+				if ((*src == '"') && (src[1] == '"'))
+					*dst++ = *++src;
+				else if (*src == '"')
+					break;
+				else
+					*dst++ = *src;
+			}
+			if (*src == '"') ++src;
+		}
+		while (*src && (*src != ',') && (*src != '\n') &&
+		       (*src != '\r'))
+			*dst++ = *src++;
+		if (*src != ',') {
+			*dst = '\0';
+			break;
+		}
+		++src;
+		*dst = '\0';
+	}
+
+	return num;
+}
+
+static int find_column(char **fields, int num_fields, const char *name) {
+	int i;
+
+	for (i = 0; i < num_fields; ++i) {
+		if (strcmp(fields[i], name) == 0) return i;
+	}
+	fprintf(stderr, "ERROR: no column '%s'. Abort!\n", name);
+	exit(-1);
+}
+
+/* the records of a CSV report (-F csv) */
+static void load_csv(FILE *file, cmp_set_t *set) {
+	char *line = NULL;
+	size_t size = 0;
+	char *fields[MAXFIELDS];
+	int num_fields;
+	int col_bench, col_variant, col_bytes, col_samples, col_median;
+	cmp_record_t *rec;
+
+	if (getline(&line, &size, file) < 0) {
+		fprintf(stderr, "ERROR: '%s' is empty. Abort!\n", set->name);
+		exit(-1);
+	}
+	num_fields = split_csv(line, fields, MAXFIELDS);
+	col_bench = find_column(fields, num_fields, "benchmark");
+	col_variant = find_column(fields, num_fields, "variant");
+	col_bytes = find_column(fields, num_fields, "bytes");
+	col_samples = find_column(fields, num_fields, "samples");
+	col_median = find_column(fields, num_fields, "median");
+
+	while (getline(&line, &size, file) >= 0) {
+		num_fields = split_csv(line, fields, MAXFIELDS);
+		if (num_fields <= col_median) continue;
+
+		rec = add_record(set);
+		strncpy(rec->benchmark, fields[col_bench],
+			REPORT_RAW_NAME_LEN - 1);
+		strncpy(rec->variant, fields[col_variant],
+			REPORT_RAW_NAME_LEN - 1);
+		rec->length = strtoull(fields[col_bytes], NULL, 10);
+		rec->count = strtoull(fields[col_samples], NULL, 10);
+		rec->median = strtod(fields[col_median], NULL);
+	}
+	free(line);
+}
+
+static void load_set(const char *name, cmp_set_t *set) {
+	char magic[sizeof(REPORT_RAW_MAGIC)];
+	FILE *file;
+
+	memset(set, 0, sizeof(cmp_set_t));
+	set->name = name;
+	if (!(file = fopen(name, "rb"))) {
+		fprintf(stderr, "ERROR: cannot open '%s'. Abort!\n", name);
+		exit(-1);
+	}
+
+	/* raw dumps start with the magic, CSV reports with the header */
+	if ((fread(magic, sizeof(magic), 1, file) == 1) &&
+	    (memcmp(magic, REPORT_RAW_MAGIC, sizeof(magic)) == 0)) {
+		rewind(file);
+		load_raw(file, set);
+	} else {
+		rewind(file);
+		load_csv(file, set);
+	}
+	fclose(file);
+}
+
+static void free_set(cmp_set_t *set) {
+	uint32_t i;
+
+	for (i = 0; i < set->num_records; ++i) free(set->records[i].samples);
+	free(set->records);
+}
+
+/*
+ * relative change from 'base' to 'cand' in percent; a zero baseline (e.g.,
+ * below the timer resolution) gives 0 if unchanged and +/-inf otherwise
+ */
+static double relative_change(double base, double cand) {
+	if (base == 0) {
+		if (cand == 0) return 0;
+		return (cand > 0) ? INFINITY : -INFINITY;
+	}
+
+	return (cand - base) / base * 100;
+}
+
+static double resample_median(const double *samples, uint64_t count,
+			      double *scratch) {
+	uint64_t i;
+
+	for (i = 0; i < count; ++i)
+		scratch[i] = samples[(uint64_t)rand() * count /
+				     ((uint64_t)RAND_MAX + 1)];
+
+	return stat_eval_median(scratch, count);
+}
+
+/*
+ * percentile bootstrap of the relative median difference (b-a)/a in
+ * percent; 'lower' and 'upper' bound the given confidence
+ */
+static void bootstrap(const cmp_record_t *a, const cmp_record_t *b,
+		      uint32_t resamples, double confidence, double *lower,
+		      double *upper) {
+	uint64_t max_count = (a->count > b->count) ? a->count : b->count;
+	double *scratch = (double *)malloc(sizeof(double) * max_count);
+	double *diffs = (double *)malloc(sizeof(double) * resamples);
+	double med_a, med_b, tail = (100 - confidence) / 200;
+	uint32_t i;
+
+	for (i = 0; i < resamples; ++i) {
+		med_a = resample_median(a->samples, a->count, scratch);
+		med_b = resample_median(b->samples, b->count, scratch);
+		diffs[i] = relative_change(med_a, med_b);
+	}
+	qsort(diffs, resamples, sizeof(double), compare_time_stamp_vals);
+	*lower = diffs[(uint32_t)(tail * (resamples - 1))];
+	*upper = diffs[(uint32_t)((1 - tail) * (resamples - 1))];
+
+	free(scratch);
+	free(diffs);
+}
+
+static cmp_record_t *find_record(cmp_set_t *set, const cmp_record_t *key) {
+	uint32_t i;
+
+	for (i = 0; i < set->num_records; ++i) {
+		cmp_record_t *rec = &set->records[i];
+
+		if (!rec->matched && (rec->length == key->length) &&
+		    !strcmp(rec->benchmark, key->benchmark) &&
+		    !strcmp(rec->variant, key->variant))
+			return rec;
+	}
+
+	return NULL;
+}
+
+int main(int argc, char **argv) {
+	int arg;
+	uint32_t i;
+	double threshold = DEFAULTTHRESHOLD;
+	double alpha = DEFAULTALPHA;
+	double confidence = DEFAULTCONFIDENCE;
+	uint32_t resamples = DEFAULTRESAMPLES;
+	unsigned int seed = DEFAULTSEED;
+	cmp_set_t base, cand;
+	cmp_record_t *a, *b;
+	double change, p_value, lower, upper;
+	bool tested, significant;
+	const char *verdict;
+	uint32_t regressions = 0, improvements = 0, compared = 0;
+
+	/* determine arguments */
+	while ((arg = getopt(argc, argv, "t:a:c:n:s:h")) != -1) {
+		switch (arg) {
+			case 't':
+				threshold = atof(optarg);
+				break;
+			case 'a':
+				alpha = atof(optarg);
+				break;
+			case 'c':
+				confidence = atof(optarg);
+				break;
+			case 'n':
+				resamples = atoi(optarg);
+				break;
+			case 's':
+				seed = atoi(optarg);
+				break;
+			case 'h':
+				printf(
+				    "usage %s [-t regression threshold in %% "
+				    "(def: %g)] "
+				    "[-a significance level (def: %g)] "
+				    "[-c bootstrap confidence in %% (def: %g)] "
+				    "[-n bootstrap resamples (def: %d)] "
+				    "[-s seed (def: %d)] "
+				    "baseline candidate\n"
+				    "files: raw sample dumps (-D) or CSV "
+				    "reports (-F csv)\n"
+				    "exit code 1: a slowdown exceeds the "
+				    "threshold\n",
+				    argv[0], DEFAULTTHRESHOLD, DEFAULTALPHA,
+				    DEFAULTCONFIDENCE, DEFAULTRESAMPLES,
+				    DEFAULTSEED);
+				exit(0);
+		}
+	}
+	if (argc - optind != 2) {
+		fprintf(stderr, "ERROR: need a baseline and a candidate "
+			"file. Abort!\n");
+		exit(-1);
+	}
+	if (resamples < 2) resamples = 2;
+	srand(seed);
+
+	load_set(argv[optind], &base);
+	load_set(argv[optind + 1], &cand);
+
+	printf("#Baseline   : %s (%u records)\n", base.name,
+	       base.num_records);
+	printf("#Candidate  : %s (%u records)\n", cand.name,
+	       cand.num_records);
+	printf("#Threshold  : %.2f%% slowdown (alpha %g, %g%% bootstrap CI)\n",
+	       threshold, alpha, confidence);
+	printf("#%-15s %-10s %10s %10s %10s %10s %10s %9s %-19s %9s  %s\n",
+	       "benchmark", "variant", "bytes", "n-base", "n-cand",
+	       "med-base", "med-cand", "change", "   CI of change", "p-value",
+	       "verdict");
+
+	for (i = 0; i < base.num_records; ++i) {
+		a = &base.records[i];
+		if (!(b = find_record(&cand, a))) continue;
+		a->matched = b->matched = true;
+		compared++;
+
+		change = relative_change(a->median, b->median);
+		tested = a->samples && b->samples && (a->count > 1) &&
+			 (b->count > 1);
+		printf("%-16s %-10s %10" PRIu64 " %10" PRIu64 " %10" PRIu64
+		       " %10.2f %10.2f %+8.2f%%",
+		       a->benchmark, a->variant, a->length, a->count, b->count,
+		       a->median, b->median, change);
+
+		if (tested) {
+			p_value = stat_eval_mann_whitney(a->samples, a->count,
+							 b->samples, b->count);
+			bootstrap(a, b, resamples, confidence, &lower, &upper);
+			significant = (p_value < alpha) &&
+				      ((lower > 0) || (upper < 0));
+			printf(" [%+7.2f%%,%+7.2f%%] %9.2e", lower, upper,
+			       p_value);
+		} else {
+			/* summaries: only the medians are known */
+			significant = true;
+			printf(" %-19s %9s", "   n/a", "n/a");
+		}
+
+		if (significant && (change > threshold)) {
+			verdict = "REGRESSION";
+			regressions++;
+		} else if (significant && (change < -threshold)) {
+			verdict = "improvement";
+			improvements++;
+		} else if (significant && (change != 0)) {
+			verdict = (change > 0) ? "slower" : "faster";
+		} else {
+			verdict = "same";
+		}
+		printf("  %s\n", verdict);
+	}
+
+	for (i = 0; i < base.num_records; ++i) {
+		if (!base.records[i].matched)
+			printf("#only in baseline : %s %s %" PRIu64 "\n",
+			       base.records[i].benchmark,
+			       base.records[i].variant,
+			       base.records[i].length);
+	}
+	for (i = 0; i < cand.num_records; ++i) {
+		if (!cand.records[i].matched)
+			printf("#only in candidate: %s %s %" PRIu64 "\n",
+			       cand.records[i].benchmark,
+			       cand.records[i].variant,
+			       cand.records[i].length);
+	}
+	printf("#Compared   : %u records, %u regressions, %u improvements\n",
+	       compared, regressions, improvements);
+
+	free_set(&base);
+	free_set(&cand);
+
+	if (compared == 0) {
+		fprintf(stderr, "ERROR: no common records. Abort!\n");
+		exit(-1);
+	}
+
+	return regressions ? 1 : 0;
+}
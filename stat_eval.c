@@ -1,5 +1,86 @@
+#include <string.h>
+
 #include <stat_eval.h>
 
+/* tail latency configuration shared by all evaluations */
+static uint32_t num_percentiles = 3;
+static double percentiles[STAT_EVAL_MAX_PERCENTILES] = { 99, 99.9, 99.99 };
+static uint64_t warmup_samples = 0;
+
+/* 
+ * set the reported percentiles from a comma-separated list (e.g.,
+ * "99,99.9,99.99"); returns -1 and keeps the old setting on malformed input
+ */
+int
+stat_eval_set_percentiles(const char *list) {
+	double parsed[STAT_EVAL_MAX_PERCENTILES];
+	uint32_t num = 0;
+	const char *pos = list;
+	char *end;
+
+	while (*pos != '\0') {
+		if (num == STAT_EVAL_MAX_PERCENTILES)
+			return -1;
+
+		parsed[num] = strtod(pos, &end);
+		if ((end == pos) || (parsed[num] < 0) || (parsed[num] > 100))
+			return -1;
+		num++;
+
+		if (*end == ',')
+			end++;
+		else if (*end != '\0')
+			return -1;
+		pos = end;
+	}
+
+	memcpy(percentiles, parsed, num*sizeof(double));
+	num_percentiles = num;
+
+	return 0;
+}
+
+/* copy the configured percentiles to 'list' (STAT_EVAL_MAX_PERCENTILES) */
+uint32_t
+stat_eval_get_percentiles(double *list) {
+	memcpy(list, percentiles, num_percentiles*sizeof(double));
+	return num_percentiles;
+}
+
+/* exclude the first 'samples' samples from the steady-state maximum */
+void
+stat_eval_set_warmup(uint64_t samples) {
+	warmup_samples = samples;
+}
+
+/* map a sample to its power-of-two histogram bucket */
+static inline uint32_t
+hist_bucket(double value) {
+	int exp;
+
+	if (!(value > 0))
+		return 0;
+
+	frexp(value, &exp);
+	exp -= STAT_EVAL_HIST_MIN_EXP+1;
+	if (exp < 0)
+		return 0;
+	if (exp >= STAT_EVAL_HIST_BUCKETS)
+		return STAT_EVAL_HIST_BUCKETS-1;
+
+	return exp;
+}
+
+/* compare two ranks for sorting the selection targets */
+static int
+compare_ranks(const void *elem1,
+	      const void *elem2) {
+	int64_t val1 = *((const int64_t*)elem1);
+	int64_t val2 = *((const int64_t*)elem2);
+
+	return (val1 > val2) - (val1 < val2);
+}
+
 /* function for comparing two double values */
 int 
 compare_time_stamp_vals(const void *elem1, 
@@ -17,6 +98,102 @@ compare_time_stamp_vals(const void *elem1,
 }
 
 
+/* 
+ * introselect: move the k-th smallest value of values[lo, hi) to position k
+ * with all smaller values left and all larger values right of it. Falls back
+ * to sorting the remaining range if the partitioning degenerates.
+ */
+static void
+select_kth(double *values,
+	   int64_t lo,
+	   int64_t hi,
+	   int64_t k) {
+	int64_t i, j, mid;
+	uint32_t depth = 0;
+	double pivot, tmp;
+
+	for (i=hi-lo; i>1; i>>=1)
+		depth += 2;
+
+	while (hi-lo > 16) {
+		if (depth-- == 0) {
+			qsort(values+lo, hi-lo, sizeof(double), 
+			    compare_time_stamp_vals);
+			return;
+		}
+
+		/* median-of-three pivot */
+		mid = lo+(hi-1-lo)/2;
+		if (values[mid] < values[lo]) {
+			tmp = values[mid];
+			values[mid] = values[lo];
+			values[lo] = tmp;
+		}
+		if (values[hi-1] < values[lo]) {
+			tmp = values[hi-1];
+			values[hi-1] = values[lo];
+			values[lo] = tmp;
+		}
+		if (values[hi-1] < values[mid]) {
+			tmp = values[hi-1];
+			values[hi-1] = values[mid];
+			values[mid] = tmp;
+		}
+		pivot = values[mid];
+
+		/* Hoare partitioning */
+		i = lo-1;
+		j = hi;
+		for (;;) {
+			do { i++; } while (values[i] < pivot);
+			do { j--; } while (values[j] > pivot);
+			if (i >= j)
+				break;
+			tmp = values[i]; values[i] = values[j]; values[j] = tmp;
+		}
+
+		if (k <= j)
+			hi = j+1;
+		else
+			lo = j+1;
+	}
+
+	/* insertion sort for the small remainder */
+	for (i=lo+1; i<hi; ++i) {
+		tmp = values[i];
+		for (j=i; (j>lo) && (values[j-1] > tmp); --j)
+			values[j] = values[j-1];
+		values[j] = tmp;
+	}
+}
+
+/* 
+ * place every rank of the ascending list 'ranks' at its sorted position by
+ * selecting the middle one and recursing into both partitions
+ */
+static void
+multi_select(double *values,
+	     int64_t lo,
+	     int64_t hi,
+	     const int64_t *ranks,
+	     uint32_t num_ranks) {
+	uint32_t m;
+
+	while ((num_ranks > 0) && (ranks[0] < lo)) {
+		ranks++;
+		num_ranks--;
+	}
+	while ((num_ranks > 0) && (ranks[num_ranks-1] >= hi))
+		num_ranks--;
+	if ((num_ranks == 0) || (hi-lo < 2))
+		return;
+
+	m = num_ranks/2;
+	select_kth(values, lo, hi, ranks[m]);
+	multi_select(values, lo, ranks[m], ranks, m);
+	multi_select(values, ranks[m]+1, hi, ranks+m+1, num_ranks-m-1);
+}
+
 /* helper function for the box-plot evaluation */
 static inline void
 box_plot_evaluation(double *values, 
@@ -74,25 +251,32 @@ box_plot_evaluation(double *values,
 	double iqr = box_plot->upper_quartil-
 	    box_plot->lower_quartil;
 
-	/* lower whisker and outlier */
-	box_plot->lower_outlier_idx = 0;
-	while (values[box_plot->lower_outlier_idx] < 
-	    (box_plot->lower_quartil-1.5*iqr)) {
-		box_plot->lower_outlier_idx++;
-	}
-	box_plot->lower_whisker = 
-	    values[box_plot->lower_outlier_idx];
-	box_plot->lower_outlier = box_plot->lower_outlier_idx;
+	/* 
+	 * values are only partially ordered, so count the outliers and find
+	 * the whiskers in a single linear pass
+	 */
+	double lower_thresh = box_plot->lower_quartil-1.5*iqr;
+	double upper_thresh = box_plot->upper_quartil+1.5*iqr;
+	unsigned int i, lower_cnt = 0, upper_cnt = 0;
 
-	/* upper whisker and outlier */
-	box_plot->upper_outlier_idx = iterations-1;
-	while (values[box_plot->upper_outlier_idx] > 
-	    (box_plot->upper_quartil+1.5*iqr)) {
-		box_plot->upper_outlier_idx--;
+	box_plot->lower_whisker = INFINITY;
+	box_plot->upper_whisker = -INFINITY;
+	for (i=0; i<iterations; ++i) {
+		if (values[i] < lower_thresh)
+			lower_cnt++;
+		else if (values[i] < box_plot->lower_whisker)
+			box_plot->lower_whisker = values[i];
+
+		if (values[i] > upper_thresh)
+			upper_cnt++;
+		else if (values[i] > box_plot->upper_whisker)
+			box_plot->upper_whisker = values[i];
 	}
-	box_plot->upper_whisker = 
-	    values[box_plot->upper_outlier_idx];
-	box_plot->upper_outlier = (iterations-1)-box_plot->upper_outlier_idx;
+
+	box_plot->lower_outlier_idx = lower_cnt;
+	box_plot->lower_outlier = lower_cnt;
+	box_plot->upper_outlier_idx = (iterations-1)-upper_cnt;
+	box_plot->upper_outlier = upper_cnt;
 }
 
 /* function for performing a statistical evaluation on an array of doubles */
@@ -107,44 +291,227 @@ statistical_eval(double *values,
 		return;
 	}
 	
-	/* sort the results */
-	qsort(values, iterations, sizeof(double), compare_time_stamp_vals);
-	
-	/* determine basic properties */
-	stat_values->minimum = values[0];
-	stat_values->maximum = values[iterations-1];
+	/* 
+	 * determine basic properties in one pass over the chronologically
+	 * ordered samples (Welford's method)
+	 */
+	tail_vals_t *tail = &(stat_values->tail);
+	double delta, m2 = 0;
+
+	memset(tail, 0, sizeof(tail_vals_t));
+	tail->warmup = warmup_samples;
+	tail->steady_maximum = -INFINITY;
 
+	stat_values->minimum = values[0];
+	stat_values->maximum = values[0];
 	stat_values->average = 0;
 	for (i=0; i<iterations; ++i) {
-		stat_values->average += values[i];
-	}
-	stat_values->average /= iterations;
+		if (values[i] < stat_values->minimum)
+			stat_values->minimum = values[i];
+		if (values[i] > stat_values->maximum)
+			stat_values->maximum = values[i];
+		if ((i >= warmup_samples) && (values[i] > tail->steady_maximum))
+			tail->steady_maximum = values[i];
 
-	stat_values->variance = 0;
-	for (i=0; i<iterations; ++i) {
-		stat_values->variance += 
-		    (stat_values->average-values[i])*
-		    (stat_values->average-values[i]);
+		delta = values[i]-stat_values->average;
+		stat_values->average += delta/(i+1);
+		m2 += delta*(values[i]-stat_values->average);
+
+		tail->histogram[hist_bucket(values[i])]++;
 	}
-	stat_values->variance /= (iterations-1);
+	stat_values->variance = m2/(iterations-1);
 
 	stat_values->std_devation = sqrt(stat_values->variance);
 
+	/* 
+	 * move the order statistics needed by box_plot_evaluation() and the
+	 * percentiles to their sorted positions (O(n) on average instead of
+	 * sorting everything)
+	 */
+	int64_t n = iterations;
+	int64_t ranks[7+2*STAT_EVAL_MAX_PERCENTILES] = { n/4-1, n/4, n/2-1, 
+		n/2, n*3/4-1, n*3/4, n*3/4+1 };
+	uint32_t num_ranks = 7;
+
+	for (i=0; i<num_percentiles; ++i) {
+		ranks[num_ranks++] = (int64_t)(percentiles[i]/100*(n-1));
+		ranks[num_ranks++] = (int64_t)(percentiles[i]/100*(n-1))+1;
+	}
+	qsort(ranks, num_ranks, sizeof(int64_t), compare_ranks);
+	multi_select(values, 0, n, ranks, num_ranks);
+
+	/* percentiles with linear interpolation between order statistics */
+	tail->num_percentiles = num_percentiles;
+	for (i=0; i<num_percentiles; ++i) {
+		double pos = percentiles[i]/100*(n-1);
+		int64_t lo = (int64_t)pos;
+
+		tail->percentiles[i] = percentiles[i];
+		tail->percentile_vals[i] = values[lo];
+		if (lo+1 < n)
+			tail->percentile_vals[i] += 
+			    (pos-lo)*(values[lo+1]-values[lo]);
+	}
+
 	/* determine boxplot parameters */
 	box_plot_evaluation(values, iterations, &(stat_values->box_plot));	
 		
 }
 
+/* median of 'values'; the values are reordered */
+double
+stat_eval_median(double *values,
+		 uint64_t count) {
+	int64_t n = count;
+	int64_t ranks[2] = { n/2-1, n/2 };
+
+	if (n == 0)
+		return NAN;
+	if (n%2) {
+		select_kth(values, 0, n, n/2);
+		return values[n/2];
+	}
+	multi_select(values, 0, n, ranks, 2);
+
+	return (values[n/2-1]+values[n/2])/2;
+}
+
+/* two-sided quantile of the standard normal distribution by bisection */
+static double
+normal_quantile(double confidence) {
+	double lo = 0, hi = 10, mid;
+	uint32_t i;
+
+	for (i=0; i<64; ++i) {
+		mid = (lo+hi)/2;
+		if (erfc(mid/M_SQRT2) > 1-confidence/100)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	return (lo+hi)/2;
+}
+
+/*
+ * distribution-free confidence interval of the median: the order statistics
+ * n/2 -/+ z*sqrt(n)/2 enclose the median with the given 'confidence' (in
+ * percent); 'values' is left untouched. Returns -1 if there are too few
+ * samples for the requested confidence.
+ */
+int
+stat_eval_median_ci(const double *values,
+		    uint64_t count,
+		    double confidence,
+		    double *median,
+		    double *lower,
+		    double *upper) {
+	int64_t n = count;
+	double half = normal_quantile(confidence)*sqrt((double)n)/2;
+	int64_t ranks[4];
+	double *copy;
+
+	ranks[0] = (int64_t)floor(n/2.0-half)-1;
+	ranks[3] = (int64_t)ceil(n/2.0+half);
+	if ((n < 2) || (ranks[0] < 0) || (ranks[3] > n-1))
+		return -1;
+	ranks[1] = n/2-1;
+	ranks[2] = n/2;
+
+	copy = (double *)malloc(sizeof(double)*n);
+	if (copy == NULL)
+		return -1;
+	memcpy(copy, values, sizeof(double)*n);
+	multi_select(copy, 0, n, ranks, 4);
+
+	*median = (n%2) ? copy[n/2] : (copy[n/2-1]+copy[n/2])/2;
+	*lower = copy[ranks[0]];
+	*upper = copy[ranks[3]];
+	free(copy);
+
+	return 0;
+}
+
+/* a sample of either set for the rank-sum test */
+typedef struct _ranked_t {
+	double value;
+	int set;
+} ranked_t;
+
+static int
+compare_ranked(const void *elem1,
+	       const void *elem2) {
+	double val1 = ((const ranked_t*)elem1)->value;
+	double val2 = ((const ranked_t*)elem2)->value;
+
+	return (val1 > val2) - (val1 < val2);
+}
+
+/*
+ * two-sided p-value of the Mann-Whitney U test of 'a' against 'b' (normal
+ * approximation with continuity and tie correction)
+ */
+double
+stat_eval_mann_whitney(const double *a,
+		       uint64_t n_a,
+		       const double *b,
+		       uint64_t n_b) {
+	uint64_t i, j, first, n = n_a+n_b;
+	ranked_t *all;
+	double rank_sum = 0, ties = 0, t, u, mean, var, z;
+
+	if ((n_a == 0) || (n_b == 0))
+		return 1;
+	all = (ranked_t *)malloc(sizeof(ranked_t)*n);
+	if (all == NULL)
+		return NAN;
+	for (i=0; i<n_a; ++i) {
+		all[i].value = a[i];
+		all[i].set = 0;
+	}
+	for (i=0; i<n_b; ++i) {
+		all[n_a+i].value = b[i];
+		all[n_a+i].set = 1;
+	}
+	qsort(all, n, sizeof(ranked_t), compare_ranked);
+
+	/* the run [first, j) of tied values shares the mean rank */
+	for (first=0; first<n; first=j) {
+		for (j=first+1;
+		     (j<n) && (all[j].value == all[first].value); ++j)
+			;
+		t = j-first;
+		ties += t*t*t-t;
+		for (i=first; i<j; ++i) {
+			if (all[i].set == 0)
+				rank_sum += (first+j+1)/2.0;
+		}
+	}
+	free(all);
+
+	u = rank_sum-n_a*(n_a+1)/2.0;
+	mean = n_a*(double)n_b/2;
+	var = n_a*(double)n_b/12*((n+1)-ties/(n*(n-1.0)));
+	if (!(var > 0))
+		return 1;
+	z = (fabs(u-mean)-0.5)/sqrt(var);
+	if (z < 0)
+		z = 0;
+
+	return erfc(z/M_SQRT2);
+}
+
 /* print the reults of a statistical evalution to 'output' */
 void 
 print_statistics(const stat_eval_t *stat_values,
-    		 uint32_t iterations,
+    		 uint64_t iterations,
     		 FILE *output) {
+	uint32_t i, first, last;
 
 	fprintf(output, "\n");
 	fprintf(output, "##----------------------------------------------\n");
 	fprintf(output, "##----------------------------------------------\n");
-	fprintf(output, "#Iterations     %d\n", iterations);
+	fprintf(output, "#Iterations     %" PRIu64 "\n", iterations);
 	fprintf(output, "#Minimum        %.2f\n", stat_values->minimum);
 	fprintf(output, "#Maximum        %.2f\n", stat_values->maximum);
 	fprintf(output, "#Average        %.2f\n", stat_values->average);
@@ -156,8 +523,39 @@ print_statistics(const stat_eval_t *stat_values,
 	fprintf(output, "#Upper Quartil  %.2f\n", stat_values->box_plot.upper_quartil);
 	fprintf(output, "#Lower Whisker  %.2f\n", stat_values->box_plot.lower_whisker);
 	fprintf(output, "#Upper Whisker  %.2f\n", stat_values->box_plot.upper_whisker);
-	fprintf(output, "#Lower Outlier  %d\n", stat_values->box_plot.lower_outlier);
-	fprintf(output, "#Upper Outlier  %d\n", stat_values->box_plot.upper_outlier);
+	fprintf(output, "#Lower Outlier  %" PRIu64 "\n", stat_values->box_plot.lower_outlier);
+	fprintf(output, "#Upper Outlier  %" PRIu64 "\n", stat_values->box_plot.upper_outlier);
+	fprintf(output, "##----------------------------------------------\n");
+	for (i=0; i<stat_values->tail.num_percentiles; ++i) {
+		fprintf(output, "#P%-13g %.2f\n", 
+			stat_values->tail.percentiles[i],
+			stat_values->tail.percentile_vals[i]);
+	}
+	if ((stat_values->tail.warmup > 0) && 
+	    (stat_values->tail.warmup < iterations)) {
+		fprintf(output,
+			"#Steady Max     %.2f (w/o first %" PRIu64 ")\n",
+			stat_values->tail.steady_maximum,
+			stat_values->tail.warmup);
+	}
+	fprintf(output, "##----------------------------------------------\n");
+	fprintf(output, "#Histogram [usec]           Count\n");
+	for (first=0; first<STAT_EVAL_HIST_BUCKETS-1; ++first) {
+		if (stat_values->tail.histogram[first])
+			break;
+	}
+	for (last=STAT_EVAL_HIST_BUCKETS-1; last>first; --last) {
+		if (stat_values->tail.histogram[last])
+			break;
+	}
+	for (i=first; i<=last; ++i) {
+		fprintf(output, "#%s%10.4g, %10.4g%s %10" PRIu64 "\n",
+			(i == 0) ? "(" : "[",
+			(i == 0) ? 0 : ldexp(1, i+STAT_EVAL_HIST_MIN_EXP),
+			ldexp(1, i+1+STAT_EVAL_HIST_MIN_EXP),
+			(i == STAT_EVAL_HIST_BUCKETS-1) ? "+" : ")",
+			stat_values->tail.histogram[i]);
+	}
 	fprintf(output, "test_run_xy  %.4f %.4f %.4f %.4f %.4f\n", 
 	    	stat_values->box_plot.median,
 		stat_values->box_plot.upper_quartil,
@@ -168,3 +566,238 @@ print_statistics(const stat_eval_t *stat_values,
 	return;
 }
 
+
+/* map a sample to its log-bucketed histogram bin */
+static inline uint32_t
+stream_eval_bucket(double value) {
+	int exp;
+	double mant;
+	uint32_t sub;
+
+	if (!(value > 0))
+		return 0;
+
+	/* value = mant * 2^exp with mant in [0.5, 1) */
+	mant = frexp(value, &exp);
+	if (exp <= STREAM_EVAL_MIN_EXP)
+		return 0;
+	if (exp > STREAM_EVAL_MAX_EXP)
+		return STREAM_EVAL_NUM_BUCKETS-1;
+
+	sub = (uint32_t)((mant-0.5)*2*STREAM_EVAL_SUB_BUCKETS);
+	if (sub >= STREAM_EVAL_SUB_BUCKETS)
+		sub = STREAM_EVAL_SUB_BUCKETS-1;
+
+	return (exp-STREAM_EVAL_MIN_EXP-1)*STREAM_EVAL_SUB_BUCKETS + sub;
+}
+
+/* representative value (center) of a histogram bin clamped to [min, max] */
+static inline double
+stream_eval_bucket_val(const stream_eval_t *stream,
+		       uint32_t bucket) {
+	int exp = bucket/STREAM_EVAL_SUB_BUCKETS + STREAM_EVAL_MIN_EXP + 1;
+	uint32_t sub = bucket%STREAM_EVAL_SUB_BUCKETS;
+	double value = ldexp(0.5 + (sub+0.5)/(2*STREAM_EVAL_SUB_BUCKETS), exp);
+
+	if (value < stream->minimum)
+		return stream->minimum;
+	if (value > stream->maximum)
+		return stream->maximum;
+
+	return value;
+}
+
+/* return the sample with the (0-based) rank 'rank' in sorted order */
+static double
+stream_eval_rank(const stream_eval_t *stream,
+		 uint64_t rank) {
+	uint32_t i;
+	uint64_t cum = 0;
+
+	for (i=0; i<STREAM_EVAL_NUM_BUCKETS; ++i) {
+		cum += stream->buckets[i];
+		if (cum > rank)
+			return stream_eval_bucket_val(stream, i);
+	}
+
+	return stream->maximum;
+}
+
+/* same interpolation as box_plot_evaluation() for the sorted case */
+static double
+stream_eval_quantile(const stream_eval_t *stream,
+		     uint64_t lo_rank,
+		     uint64_t hi_rank) {
+	if (lo_rank == hi_rank)
+		return stream_eval_rank(stream, lo_rank);
+
+	return (stream_eval_rank(stream, lo_rank)+
+		stream_eval_rank(stream, hi_rank))/2;
+}
+
+/* reset a streaming estimator */
+void
+stream_eval_init(stream_eval_t *stream) {
+	memset(stream, 0, sizeof(stream_eval_t));
+	stream->minimum = INFINITY;
+	stream->maximum = -INFINITY;
+	stream->steady_maximum = -INFINITY;
+}
+
+/* add one sample in O(1) (Welford's update for mean and variance) */
+void
+stream_eval_add(stream_eval_t *stream, 
+		double value) {
+	double delta;
+
+	stream->count++;
+	if (value < stream->minimum)
+		stream->minimum = value;
+	if (value > stream->maximum)
+		stream->maximum = value;
+
+	if ((stream->count > warmup_samples) && 
+	    (value > stream->steady_maximum))
+		stream->steady_maximum = value;
+
+	delta = value-stream->mean;
+	stream->mean += delta/stream->count;
+	stream->m2 += delta*(value-stream->mean);
+
+	stream->buckets[stream_eval_bucket(value)]++;
+}
+
+/* merge 'other' into 'stream' (e.g., estimators gathered from other ranks) */
+void
+stream_eval_merge(stream_eval_t *stream,
+		  const stream_eval_t *other) {
+	uint64_t n;
+	uint32_t i;
+	double delta;
+
+	if (other->count == 0)
+		return;
+
+	/* Chan et al.'s pairwise update for mean and variance */
+	n = stream->count+other->count;
+	delta = other->mean-stream->mean;
+	stream->mean += delta*other->count/n;
+	stream->m2 += other->m2+
+	    delta*delta*((double)stream->count*other->count/n);
+	stream->count = n;
+
+	if (other->minimum < stream->minimum)
+		stream->minimum = other->minimum;
+	if (other->maximum > stream->maximum)
+		stream->maximum = other->maximum;
+	if (other->steady_maximum > stream->steady_maximum)
+		stream->steady_maximum = other->steady_maximum;
+
+	for (i=0; i<STREAM_EVAL_NUM_BUCKETS; ++i)
+		stream->buckets[i] += other->buckets[i];
+}
+
+/* derive a statistical evaluation from a streaming estimator */
+void
+stream_eval_finalize(const stream_eval_t *stream,
+		     stat_eval_t *stat_values) {
+	uint64_t n, cum;
+	uint32_t i;
+	double iqr, thresh;
+	box_plot_vals_t *box_plot;
+
+	/* error check */
+	if ((stream == NULL) || (stream->count == 0) || (stat_values == NULL)) {
+		return;
+	}
+
+	n = stream->count;
+	box_plot = &(stat_values->box_plot);
+
+	stat_values->minimum = stream->minimum;
+	stat_values->maximum = stream->maximum;
+	stat_values->average = stream->mean;
+	stat_values->variance = (n > 1) ? stream->m2/(n-1) : 0;
+	stat_values->std_devation = sqrt(stat_values->variance);
+
+	/* median and quartiles */
+	if (n%2 == 0)
+		box_plot->median = stream_eval_quantile(stream, n/2-1, n/2);
+	else
+		box_plot->median = stream_eval_quantile(stream, n/2, n/2);
+
+	if ((n/2)%2 == 0) {
+		box_plot->lower_quartil = 
+		    stream_eval_quantile(stream, n/4 ? n/4-1 : 0, n/4);
+		box_plot->upper_quartil = (n%2 == 0) ?
+		    stream_eval_quantile(stream, n*3/4-1, n*3/4) :
+		    stream_eval_quantile(stream, n*3/4, 
+			n*3/4+1 < n ? n*3/4+1 : n-1);
+	} else {
+		box_plot->lower_quartil =
+		    stream_eval_quantile(stream, n/4, n/4);
+		box_plot->upper_quartil = 
+		    stream_eval_quantile(stream, n*3/4, n*3/4);
+	}
+
+	/* whiskers and outlier */
+	iqr = box_plot->upper_quartil-box_plot->lower_quartil;
+
+	thresh = box_plot->lower_quartil-1.5*iqr;
+	cum = 0;
+	for (i=0; i<STREAM_EVAL_NUM_BUCKETS; ++i) {
+		if (stream->buckets[i] == 0)
+			continue;
+		if (stream_eval_bucket_val(stream, i) >= thresh)
+			break;
+		cum += stream->buckets[i];
+	}
+	box_plot->lower_outlier = cum;
+	box_plot->lower_whisker = (i < STREAM_EVAL_NUM_BUCKETS) ?
+	    stream_eval_bucket_val(stream, i) : stream->maximum;
+
+	thresh = box_plot->upper_quartil+1.5*iqr;
+	cum = 0;
+	for (i=STREAM_EVAL_NUM_BUCKETS; i>0; --i) {
+		if (stream->buckets[i-1] == 0)
+			continue;
+		if (stream_eval_bucket_val(stream, i-1) <= thresh)
+			break;
+		cum += stream->buckets[i-1];
+	}
+	box_plot->upper_outlier = cum;
+	box_plot->upper_whisker = (i > 0) ?
+	    stream_eval_bucket_val(stream, i-1) : stream->minimum;
+
+	/* tail latency */
+	tail_vals_t *tail = &(stat_values->tail);
+
+	memset(tail, 0, sizeof(tail_vals_t));
+	tail->warmup = warmup_samples;
+	tail->steady_maximum = stream->steady_maximum;
+	tail->num_percentiles = num_percentiles;
+	for (i=0; i<num_percentiles; ++i) {
+		double pos = percentiles[i]/100*(n-1);
+		uint64_t lo = (uint64_t)pos;
+
+		tail->percentiles[i] = percentiles[i];
+		tail->percentile_vals[i] = stream_eval_rank(stream, lo);
+		if (lo+1 < n)
+			tail->percentile_vals[i] += (pos-lo)*
+			    (stream_eval_rank(stream, lo+1)-
+			     tail->percentile_vals[i]);
+	}
+	for (i=0; i<STREAM_EVAL_NUM_BUCKETS; ++i) {
+		if (stream->buckets[i])
+			tail->histogram[hist_bucket(
+			    stream_eval_bucket_val(stream, i))] += 
+			    stream->buckets[i];
+	}
+
+	/* there is no sample array behind a stream; saturate the indices */
+	box_plot->lower_outlier_idx = (box_plot->lower_outlier > UINT32_MAX) ?
+	    UINT32_MAX : (uint32_t)box_plot->lower_outlier;
+	box_plot->upper_outlier_idx =
+	    (n-1-box_plot->upper_outlier > UINT32_MAX) ?
+	    UINT32_MAX : (uint32_t)(n-1-box_plot->upper_outlier);
+}
@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <math.h>
 
 typedef struct _box_plot_vals_t {
@@ -12,12 +13,30 @@ typedef struct _box_plot_vals_t {
 	double lower_quartil;
 	double upper_quartil;
 	double median;
-	uint32_t lower_outlier;
-	uint32_t upper_outlier;
+	uint64_t lower_outlier;
+	uint64_t upper_outlier;
 	uint32_t lower_outlier_idx;
 	uint32_t upper_outlier_idx;
 } box_plot_vals_t;
 
+/* 
+ * Tail latency: configurable percentiles (see stat_eval_set_percentiles()),
+ * the maximum without the first 'warmup' samples and a histogram with one
+ * bucket per power of two starting at 2^STAT_EVAL_HIST_MIN_EXP us.
+ */
+#define STAT_EVAL_MAX_PERCENTILES	(16)
+#define STAT_EVAL_HIST_MIN_EXP		(-4)	/* 2^-4 us = 62.5 ns */
+#define STAT_EVAL_HIST_BUCKETS		(32)
+
+typedef struct _tail_vals_t {
+	uint32_t num_percentiles;
+	double percentiles[STAT_EVAL_MAX_PERCENTILES];
+	double percentile_vals[STAT_EVAL_MAX_PERCENTILES];
+	uint64_t warmup;
+	double steady_maximum;
+	uint64_t histogram[STAT_EVAL_HIST_BUCKETS];
+} tail_vals_t;
+
 typedef struct _stat_eval_t {
 	double minimum;
 	double maximum;
@@ -25,15 +44,87 @@ typedef struct _stat_eval_t {
 	double variance;
 	double std_devation;
 	box_plot_vals_t box_plot;
+	tail_vals_t tail;
 } stat_eval_t;
 
+/*
+ * Streaming estimator for runs without a bounded number of samples (e.g.,
+ * '-r -1'). Samples are sorted into log-bucketed histogram bins (HDR-style):
+ * every power of two is split into STREAM_EVAL_SUB_BUCKETS linear bins, so
+ * quantiles are reported with a relative error below 1/(2*SUB_BUCKETS) while
+ * the memory footprint stays constant. Minimum, maximum, mean and variance
+ * are exact.
+ */
+#define STREAM_EVAL_SUB_BITS	(7)
+#define STREAM_EVAL_SUB_BUCKETS	(1 << STREAM_EVAL_SUB_BITS)
+#define STREAM_EVAL_MIN_EXP	(-10)	/* 2^-10 us ~ 1 ns */
+#define STREAM_EVAL_MAX_EXP	(32)	/* 2^32 us ~ 71 min */
+#define STREAM_EVAL_NUM_BUCKETS	\
+	((STREAM_EVAL_MAX_EXP-STREAM_EVAL_MIN_EXP)*STREAM_EVAL_SUB_BUCKETS)
+
+typedef struct _stream_eval_t {
+	uint64_t count;
+	double minimum;
+	double maximum;
+	double mean;
+	double m2;
+	double steady_maximum;
+	uint64_t buckets[STREAM_EVAL_NUM_BUCKETS];
+} stream_eval_t;
+
+int
+compare_time_stamp_vals(const void *elem1,
+			const void *elem2);
+
+int
+stat_eval_set_percentiles(const char *list);
+
+uint32_t
+stat_eval_get_percentiles(double *list);
+
+void
+stat_eval_set_warmup(uint64_t samples);
+
 void 
 statistical_eval(double *values, 
 		 uint32_t iterations, 
 		 stat_eval_t *stat_values);
 
+double
+stat_eval_median(double *values,
+		 uint64_t count);
+
+int
+stat_eval_median_ci(const double *values,
+		    uint64_t count,
+		    double confidence,
+		    double *median,
+		    double *lower,
+		    double *upper);
+
+double
+stat_eval_mann_whitney(const double *a,
+		       uint64_t n_a,
+		       const double *b,
+		       uint64_t n_b);
+
 void 
 print_statistics(const stat_eval_t *stat_values,
-		 uint32_t iterations,    	
+		 uint64_t iterations,    	
     		 FILE *output);
+
+void
+stream_eval_init(stream_eval_t *stream);
+
+void
+stream_eval_add(stream_eval_t *stream, 
+		double value);
+
+void
+stream_eval_merge(stream_eval_t *stream,
+		  const stream_eval_t *other);
+
+void
+stream_eval_finalize(const stream_eval_t *stream,
+		     stat_eval_t *stat_values);
 #endif /* _STAT_EVAL_H */
@@ -0,0 +1,184 @@
+/*
+ * Copyright 2017, Simon Pickartz Institute for Automation
+ *                                of Complex Power Systems,
+ *                                RWTH Aachen University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Microbenchmark comparing statistical_eval() against the former
+ * implementation (qsort() followed by a two-pass mean/variance).
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <stat_eval.h>
+
+#define DEFAULTSAMPLES (10000000)
+#define DEFAULTSEED (42)
+
+static double now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* the qsort-based evaluation statistical_eval() used to perform */
+static void reference_eval(double *values, uint32_t n, stat_eval_t *res) {
+	box_plot_vals_t *bp = &(res->box_plot);
+	uint32_t i;
+	double iqr;
+
+	qsort(values, n, sizeof(double), compare_time_stamp_vals);
+
+	res->minimum = values[0];
+	res->maximum = values[n - 1];
+	res->average = 0;
+	for (i = 0; i < n; ++i) res->average += values[i];
+	res->average /= n;
+	res->variance = 0;
+	for (i = 0; i < n; ++i)
+		res->variance += (res->average - values[i]) *
+				 (res->average - values[i]);
+	res->variance /= (n - 1);
+	res->std_devation = sqrt(res->variance);
+
+	if (n % 2 == 0) {
+		bp->median = (values[n / 2 - 1] + values[n / 2]) / 2;
+		if ((n / 2) % 2 == 0) {
+			bp->lower_quartil =
+			    (values[n / 4 - 1] + values[n / 4]) / 2;
+			bp->upper_quartil =
+			    (values[n * 3 / 4 - 1] + values[n * 3 / 4]) / 2;
+		} else {
+			bp->lower_quartil = values[n / 4];
+			bp->upper_quartil = values[n * 3 / 4];
+		}
+	} else {
+		bp->median = values[n / 2];
+		if ((n / 2) % 2 == 0) {
+			bp->lower_quartil =
+			    (values[n / 4 - 1] + values[n / 4]) / 2;
+			bp->upper_quartil =
+			    (values[n * 3 / 4] + values[n * 3 / 4 + 1]) / 2;
+		} else {
+			bp->lower_quartil = values[n / 4];
+			bp->upper_quartil = values[n * 3 / 4];
+		}
+	}
+
+	iqr = bp->upper_quartil - bp->lower_quartil;
+	bp->lower_outlier_idx = 0;
+	while (values[bp->lower_outlier_idx] < (bp->lower_quartil - 1.5 * iqr))
+		bp->lower_outlier_idx++;
+	bp->lower_whisker = values[bp->lower_outlier_idx];
+	bp->lower_outlier = bp->lower_outlier_idx;
+	bp->upper_outlier_idx = n - 1;
+	while (values[bp->upper_outlier_idx] > (bp->upper_quartil + 1.5 * iqr))
+		bp->upper_outlier_idx--;
+	bp->upper_whisker = values[bp->upper_outlier_idx];
+	bp->upper_outlier = (n - 1) - bp->upper_outlier_idx;
+}
+
+int main(int argc, char **argv) {
+	int arg;
+	uint32_t i;
+	uint32_t num_samples = DEFAULTSAMPLES;
+	unsigned int seed = DEFAULTSEED;
+	double *samples, *ref_samples;
+	double timer, ref_timer;
+	stat_eval_t stat_eval, ref_eval;
+
+	/* determine arguments */
+	while ((arg = getopt(argc, argv, "n:s:h")) != -1) {
+		switch (arg) {
+			case 'n':
+				num_samples = atoi(optarg);
+				break;
+			case 's':
+				seed = atoi(optarg);
+				break;
+			case 'h':
+				printf(
+				    "usage %s [-n samples (def: %d)] "
+				    "[-s seed (def: %d)]\n",
+				    argv[0], DEFAULTSAMPLES, DEFAULTSEED);
+				exit(0);
+		}
+	}
+
+	if (num_samples < 2) {
+		fprintf(stderr, "ERROR: need at least two samples. Abort!\n");
+		exit(-1);
+	}
+
+	/* latency-like samples: a narrow body with a heavy tail */
+	samples = (double *)malloc(sizeof(double) * num_samples);
+	ref_samples = (double *)malloc(sizeof(double) * num_samples);
+	srand(seed);
+	for (i = 0; i < num_samples; ++i) {
+		double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+		samples[i] = 1.0 + 0.1 * u;
+		if (!(rand() % 100)) samples[i] += -log(u) * 10;
+	}
+	memcpy(ref_samples, samples, sizeof(double) * num_samples);
+
+	ref_timer = now();
+	reference_eval(ref_samples, num_samples, &ref_eval);
+	ref_timer = now() - ref_timer;
+
+	timer = now();
+	statistical_eval(samples, num_samples, &stat_eval);
+	timer = now() - timer;
+
+	printf("Samples    : %10u\n", num_samples);
+	printf("qsort      : %10.4f s\n", ref_timer);
+	printf("select     : %10.4f s\n", timer);
+	printf("Speedup    : %10.2f\n", ref_timer / timer);
+
+	if ((stat_eval.box_plot.median != ref_eval.box_plot.median) ||
+	    (stat_eval.box_plot.lower_quartil !=
+	     ref_eval.box_plot.lower_quartil) ||
+	    (stat_eval.box_plot.upper_quartil !=
+	     ref_eval.box_plot.upper_quartil) ||
+	    (stat_eval.box_plot.lower_whisker !=
+	     ref_eval.box_plot.lower_whisker) ||
+	    (stat_eval.box_plot.upper_whisker !=
+	     ref_eval.box_plot.upper_whisker) ||
+	    (stat_eval.box_plot.lower_outlier !=
+	     ref_eval.box_plot.lower_outlier) ||
+	    (stat_eval.box_plot.upper_outlier !=
+	     ref_eval.box_plot.upper_outlier) ||
+	    (stat_eval.minimum != ref_eval.minimum) ||
+	    (stat_eval.maximum != ref_eval.maximum)) {
+		fprintf(stderr, "ERROR: results differ from qsort path!\n");
+		print_statistics(&ref_eval, num_samples, stderr);
+		print_statistics(&stat_eval, num_samples, stderr);
+		exit(-1);
+	}
+	printf("Results    :    identical\n");
+	printf("Avg diff   : %10.3e\n", stat_eval.average - ref_eval.average);
+
+	free(samples);
+	free(ref_samples);
+
+	return 0;
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2017, Simon Pickartz Institute for Automation
+ *                                of Complex Power Systems,
+ *                                RWTH Aachen University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Checks of the significance tests used by stat_cmp ('make check').
+ * Timer-quantized latencies are full of ties, so the rank-sum test is
+ * exercised with heavily tied samples as well. Exits non-zero on failure.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <stat_eval.h>
+
+#define NUMSAMPLES (2000)
+#define NUMLEVELS (4)
+#define SEED (42)
+
+static int failures = 0;
+
+static void check(int cond, const char *what, double value) {
+	printf("%-44s %12.4e  %s\n", what, value, cond ? "ok" : "FAILED");
+	if (!cond) failures++;
+}
+
+int main(void) {
+	double a[NUMSAMPLES], b[NUMSAMPLES];
+	double small[8] = {1.0, 1.5, 1.5, 2.0, 2.0, 2.0, 3.0, 4.0};
+	double p, q;
+	uint32_t i;
+
+	srand(SEED);
+
+	/* quantized to a few timer ticks: almost every sample is tied */
+	for (i = 0; i < NUMSAMPLES; ++i)
+		a[i] = b[i] = 1.0 + rand() % NUMLEVELS;
+	p = stat_eval_mann_whitney(a, NUMSAMPLES, b, NUMSAMPLES);
+	check(p > 0.99, "identical tied sets: p", p);
+
+	p = stat_eval_mann_whitney(small, 8, small, 8);
+	check(p > 0.99, "identical 8-sample sets: p", p);
+
+	/* the same quantized distribution shifted by one tick */
+	for (i = 0; i < NUMSAMPLES; ++i) b[i] = a[i] + 1.0;
+	p = stat_eval_mann_whitney(a, NUMSAMPLES, b, NUMSAMPLES);
+	check(p < 1e-6, "shifted tied sets: p", p);
+	q = stat_eval_mann_whitney(b, NUMSAMPLES, a, NUMSAMPLES);
+	check(p == q, "shifted tied sets: p symmetric", q);
+
+	/* independent draws of one continuous distribution */
+	for (i = 0; i < NUMSAMPLES; ++i) {
+		a[i] = (double)rand() / RAND_MAX;
+		b[i] = (double)rand() / RAND_MAX;
+	}
+	p = stat_eval_mann_whitney(a, NUMSAMPLES, b, NUMSAMPLES);
+	check(p > 0.001, "same distribution: p", p);
+
+	printf("%d failure(s)\n", failures);
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,294 @@
+/*
+ * Copyright 2017, Simon Pickartz Institute for Automation of Complex Power
+ * Systems,
+ *                                RWTH Aachen University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Benchmark suite. Runs a list of kernels from the registry, each over its
+ * own range of message sizes, within one MPI session. Buffers, warm-up,
+ * timing, statistics and output are shared by all kernels (see harness.h),
+ * so a new benchmark only has to provide the operation it measures. A list
+ * item is 'name[:min[-max]]'; sizes accept K and M suffixes and are swept
+ * in powers of two. Items without a range use -l/-L.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <mpi.h>
+
+#include <bcast.h>
+#include <harness.h>
+#include <kernels.h>
+#include <report.h>
+#include <setup.h>
+
+#define DEFAULTBENCHMARKS "pingpong,bcast,allreduce,barrier"
+#define DEFAULTLEN (0)
+#define DEFAULTMAXLEN (65536)
+#define DEFAULTROUNDS (1000)
+#define WARMUPROUNDS (100)
+#define MAXBENCHMARKS (32)
+
+/* one item of the benchmark list */
+typedef struct _bench_item_t {
+	const harness_kernel_t *kernel;
+	uint32_t length;
+	uint32_t maxlen;
+} bench_item_t;
+
+/* size with an optional K or M suffix */
+static int parse_size(const char *str, char **end, uint32_t *size) {
+	unsigned long long value;
+
+	value = strtoull(str, end, 0);
+	if (*end == str) return -1;
+	if (**end == 'K' || **end == 'k') {
+		value *= 1024;
+		++*end;
+	} else if (**end == 'M' || **end == 'm') {
+		value *= 1024 * 1024;
+		++*end;
+	}
+	if (value > INT32_MAX) return -1;
+	*size = (uint32_t)value;
+
+	return 0;
+}
+
+/* 'name[:min[-max]],...' into 'items'; returns the number of items or -1 */
+static int parse_benchmarks(const char *list, uint32_t length,
+			    uint32_t maxlen, bench_item_t *items) {
+	char *copy, *token, *save, *range, *end;
+	int num_items = 0;
+
+	copy = strdup(list);
+	for (token = strtok_r(copy, ",", &save); token;
+	     token = strtok_r(NULL, ",", &save)) {
+		if (num_items == MAXBENCHMARKS) goto error;
+
+		range = strchr(token, ':');
+		if (range) *range++ = '\0';
+		items[num_items].kernel = kernels_find(token);
+		if (!items[num_items].kernel) goto error;
+		items[num_items].length = length;
+		items[num_items].maxlen = maxlen;
+		if (range) {
+			if (parse_size(range, &end, &items[num_items].length))
+				goto error;
+			items[num_items].maxlen = items[num_items].length;
+			if (*end == '-') {
+				range = end + 1;
+				if (parse_size(range, &end,
+					       &items[num_items].maxlen))
+					goto error;
+			}
+			if (*end != '\0') goto error;
+		}
+		if (items[num_items].maxlen < items[num_items].length)
+			items[num_items].maxlen = items[num_items].length;
+		harness_align_range(items[num_items].kernel,
+				    &items[num_items].length,
+				    &items[num_items].maxlen);
+		++num_items;
+	}
+	free(copy);
+
+	return num_items;
+
+error:
+	free(copy);
+	return -1;
+}
+
+int main(int argc, char **argv) {
+	int arg;
+	int i;
+	uint32_t k;
+	const harness_kernel_t *kernel;
+	int32_t num_ranks;
+	int32_t my_rank;
+
+	char *benchmarks = DEFAULTBENCHMARKS;
+	bench_item_t items[MAXBENCHMARKS];
+	int num_items;
+	uint32_t length = DEFAULTLEN;
+	uint32_t maxlen = DEFAULTMAXLEN;
+	uint32_t cur_len;
+	int32_t numrounds = DEFAULTROUNDS;
+	int32_t warmup = WARMUPROUNDS;
+	size_t buffer_size = 0, size;
+	setup_t setup;
+	report_format_t format = REPORT_TEXT;
+	harness_t harness;
+
+	/* all benchmarks share one MPI session */
+	MPI_Init(&argc, &argv);
+	MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+	setup_init(&setup, my_rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+
+	/* determine arguments */
+	while ((arg = getopt(argc, argv,
+			     "b:l:L:r:W:f:F:S:h" SETUP_OPTIONS)) != -1) {
+		switch (arg) {
+			case 'b':
+				benchmarks = optarg;
+				break;
+			case 'l':
+				length = atoi(optarg);
+				break;
+			case 'L':
+				maxlen = atoi(optarg);
+				break;
+			case 'r':
+				numrounds = atoi(optarg);
+				break;
+			case 'W':
+				warmup = atoi(optarg);
+				break;
+			case 'F':
+				if (report_parse(optarg, &format)) {
+					setup_abort(my_rank,
+						    "unknown format '%s'",
+						    optarg);
+				}
+				break;
+			case 'S':
+				kernels_segment = atoi(optarg);
+				break;
+			case 'h':
+				if (my_rank == 0) {
+					printf(
+					    "usage %s [-b name[:min[-max]],... "
+					    "(def: %s)] "
+					    "[-l message_length (def: %d)] "
+					    "[-L max. message_length "
+					    "(def: %d)] "
+					    "[-r rounds (def: %d)] "
+					    "[-W warm-up rounds (def: %d)] "
+					    "[-F text|csv|json (def: text)] "
+					    "[-S pipeline segment bytes "
+					    "(def: %d)] ",
+					    argv[0], DEFAULTBENCHMARKS,
+					    DEFAULTLEN, DEFAULTMAXLEN,
+					    DEFAULTROUNDS, WARMUPROUNDS,
+					    BCAST_DEFAULT_SEGMENT);
+					setup_usage(stdout, true);
+					printf("\nsizes accept K and M "
+					       "suffixes, e.g., "
+					       "pingpong:1-64K,barrier\n");
+					printf("benchmarks:\n");
+					for (k = 0; k < kernels_count(); ++k) {
+						kernel = kernels_get(k);
+						printf("  %-20s %s\n",
+						       kernel->name,
+						       kernel->description);
+					}
+					fflush(stdout);
+				}
+				exit(0);
+			default:
+				setup_parse(&setup, arg, optarg);
+				break;
+		}
+	}
+
+	if (maxlen < length) maxlen = length;
+	if (kernels_segment < 1) kernels_segment = BCAST_DEFAULT_SEGMENT;
+	num_items = parse_benchmarks(benchmarks, length, maxlen, items);
+	if (num_items < 0) {
+		setup_abort(my_rank, "invalid benchmark list '%s' (see -h)",
+			    benchmarks);
+	}
+
+	/* select and calibrate the time source */
+	setup_timer(&setup);
+
+	/* one pair of buffers for the largest configuration */
+	for (i = 0; i < num_items; ++i) {
+		size = harness_buffer_size(items[i].kernel, items[i].maxlen,
+					   num_ranks);
+		if (size > buffer_size) buffer_size = size;
+	}
+
+	/* the banner would corrupt machine-readable output on stdout */
+	if ((my_rank == 0) && ((format == REPORT_TEXT) || setup.filename)) {
+		printf("Starting the benchmark:\n");
+		printf("Rounds     : %10d (warm-up %d)\n", numrounds, warmup);
+		printf("Ranks      : %10d\n", num_ranks);
+		printf("Benchmarks :");
+		for (i = 0; i < num_items; ++i) {
+			if (items[i].kernel->sized)
+				printf(" %s:%u-%u", items[i].kernel->name,
+				       items[i].length, items[i].maxlen);
+			else
+				printf(" %s", items[i].kernel->name);
+		}
+		printf("\n");
+		printf("Segment    : %10d\n", kernels_segment);
+		setup_print(&setup, false);
+		fflush(stdout);
+	}
+
+	setup_output(&setup);
+	harness_init(&harness, MPI_COMM_WORLD, &setup, buffer_size, numrounds,
+		     warmup, format);
+
+	for (i = 0; i < num_items; ++i) {
+		if (num_ranks < items[i].kernel->min_ranks) {
+			if (my_rank == 0) {
+				fprintf(stderr, "WARNING: %s needs at least %d "
+					"ranks, skipped.\n",
+					items[i].kernel->name,
+					items[i].kernel->min_ranks);
+			}
+			continue;
+		}
+
+		cur_len = items[i].length;
+		for (;;) {
+			if (harness_measure(&harness, items[i].kernel,
+					    cur_len) &&
+			    (my_rank == 0)) {
+				fprintf(stderr, "WARNING: cannot set up %s for "
+					"%u bytes, skipped.\n",
+					items[i].kernel->name, cur_len);
+			}
+
+			/* kernels without a payload run once */
+			if (!items[i].kernel->sized) break;
+
+			/* power-of-two sweep from one element on */
+			if (cur_len >= items[i].maxlen) break;
+			cur_len = cur_len ? cur_len * 2 : items[i].kernel->unit;
+			if (cur_len > items[i].maxlen)
+				cur_len = items[i].maxlen;
+		}
+	}
+
+	harness_finish(&harness);
+	setup_close(&setup);
+
+	MPI_Finalize();
+
+	return 0;
+}
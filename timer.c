@@ -0,0 +1,228 @@
+#include <stdlib.h>
+#include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+#include <stat_eval.h>
+#include <timer.h>
+
+#define TIMER_CALIB_NS		(20000000)	/* TSC calibration interval */
+#define TIMER_CALIB_SAMPLES	(10001)
+
+timer_backend_t timer_backend = TIMER_MPI;
+double timer_correction = 0;
+double timer_tsc_period = 0;
+uint64_t timer_tsc_base = 0;
+time_t timer_clock_base = 0;
+
+/* calibration of every backend (see timer_calibrate()) */
+static timer_calib_t timer_calibs[TIMER_NUM_BACKENDS];
+
+static const char *timer_names[TIMER_NUM_BACKENDS] = {
+	"mpi", "clock", "tsc"
+};
+
+/* translate a timer backend given on the command line */
+int
+timer_parse(const char *name,
+	    timer_backend_t *backend) {
+	int i;
+
+	for (i=0; i<TIMER_NUM_BACKENDS; ++i) {
+		if (strcmp(name, timer_names[i]) == 0) {
+			*backend = (timer_backend_t)i;
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+const char *
+timer_name(timer_backend_t backend) {
+	return (backend < TIMER_NUM_BACKENDS) ? timer_names[backend]
+					       : "unknown";
+}
+
+static inline int64_t
+raw_ns(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+	return (int64_t)ts.tv_sec*1000000000+ts.tv_nsec;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+/* only an invariant TSC ticks at a constant rate across P-/C-states */
+static int
+tsc_invariant(void) {
+	unsigned int eax, ebx, ecx, edx;
+
+	if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) ||
+	    (eax < 0x80000007))
+		return 0;
+	__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+
+	return (edx >> 8) & 1;
+}
+
+/* count TSC ticks during a busy-wait of TIMER_CALIB_NS */
+static double
+tsc_calibrate(void) {
+	unsigned int aux;
+	int64_t start, end;
+	uint64_t tsc_start, tsc_end;
+
+	start = raw_ns();
+	tsc_start = __builtin_ia32_rdtscp(&aux);
+	do {
+		end = raw_ns();
+	} while (end-start < TIMER_CALIB_NS);
+	tsc_end = __builtin_ia32_rdtscp(&aux);
+
+	return (double)(tsc_end-tsc_start)/((end-start)*1e-9);
+}
+#endif
+
+/* switch to 'backend'; returns -1 if it is not available on this CPU */
+int
+timer_select(timer_backend_t backend) {
+	struct timespec ts;
+
+	switch (backend) {
+		case TIMER_MPI:
+			break;
+		case TIMER_CLOCK:
+			if (clock_gettime(CLOCK_MONOTONIC_RAW, &ts))
+				return -1;
+			timer_clock_base = ts.tv_sec;
+			break;
+		case TIMER_TSC:
+#if defined(__x86_64__) || defined(__i386__)
+		{
+			unsigned int aux;
+
+			if (!tsc_invariant())
+				return -1;
+			timer_tsc_period = 1.0/tsc_calibrate();
+			timer_tsc_base = __builtin_ia32_rdtscp(&aux);
+			break;
+		}
+#else
+			return -1;
+#endif
+		default:
+			return -1;
+	}
+	timer_backend = backend;
+
+	return 0;
+}
+
+/* measure resolution and overhead of the active backend */
+static void
+calibrate_active(timer_calib_t *calib) {
+	double *deltas;
+	double t0, t1;
+	uint32_t i;
+
+	memset(calib, 0, sizeof(timer_calib_t));
+	calib->available = true;
+	if (timer_backend == TIMER_TSC)
+		calib->frequency = 1.0/timer_tsc_period;
+
+	/* resolution: the smallest non-zero step between two reads */
+	calib->resolution = 1;
+	for (i=0; i<TIMER_CALIB_SAMPLES; ++i) {
+		t0 = timer_now();
+		do {
+			t1 = timer_now();
+		} while (t1 == t0);
+		if (t1-t0 < calib->resolution)
+			calib->resolution = t1-t0;
+	}
+
+	/* overhead: the median of back-to-back reads */
+	deltas = (double *)malloc(sizeof(double)*TIMER_CALIB_SAMPLES);
+	for (i=0; i<TIMER_CALIB_SAMPLES; ++i) {
+		t0 = timer_now();
+		t1 = timer_now();
+		deltas[i] = t1-t0;
+	}
+	calib->overhead = stat_eval_median(deltas, TIMER_CALIB_SAMPLES);
+	free(deltas);
+}
+
+/*
+ * measure resolution and overhead of every available backend; the selected
+ * backend stays active and its calibration is returned in 'calib'
+ */
+void
+timer_calibrate(timer_calib_t *calib) {
+	timer_backend_t selected = timer_backend;
+	double tsc_period = timer_tsc_period;
+	uint64_t tsc_base = timer_tsc_base;
+	time_t clock_base = timer_clock_base;
+	int i;
+
+	for (i=0; i<TIMER_NUM_BACKENDS; ++i) {
+		memset(&timer_calibs[i], 0, sizeof(timer_calib_t));
+		if ((timer_backend_t)i == selected) {
+			/* the selected backend with its own time base */
+			timer_backend = selected;
+			timer_tsc_period = tsc_period;
+			timer_tsc_base = tsc_base;
+			timer_clock_base = clock_base;
+		} else if (timer_select((timer_backend_t)i)) {
+			continue;
+		}
+		calibrate_active(&timer_calibs[i]);
+	}
+
+	/* apply the selected backend again */
+	timer_backend = selected;
+	timer_tsc_period = tsc_period;
+	timer_tsc_base = tsc_base;
+	timer_clock_base = clock_base;
+	*calib = timer_calibs[selected];
+}
+
+/* let timer_elapsed() subtract the overhead of a read */
+void
+timer_subtract_overhead(const timer_calib_t *calib) {
+	timer_correction = calib->overhead;
+}
+
+/*
+ * one line per backend: the selected one after 'label', the others after
+ * 'indent'
+ */
+void
+timer_print_calibration(FILE *output,
+			const char *label,
+			const char *indent) {
+	const timer_calib_t *calib;
+	int i, pass;
+
+	/* the selected backend first */
+	for (pass=0; pass<2; ++pass) {
+		for (i=0; i<TIMER_NUM_BACKENDS; ++i) {
+			if (((timer_backend_t)i == timer_backend) !=
+			    (pass == 0))
+				continue;
+			calib = &timer_calibs[i];
+			fprintf(output, "%s%10s ", pass ? indent : label,
+				timer_names[i]);
+			if (!calib->available) {
+				fprintf(output, "(not available)\n");
+				continue;
+			}
+			fprintf(output,
+				"(resolution %.1f ns, overhead %.1f ns%s)\n",
+				calib->resolution*1e9, calib->overhead*1e9,
+				(pass == 0) && (timer_correction > 0)
+				    ? ", subtracted" : "");
+		}
+	}
+}
@@ -0,0 +1,95 @@
+#ifndef _TIMER_H
+#define _TIMER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <mpi.h>
+
+/*
+ * Time source of the measurements:
+ *   - mpi:   MPI_Wtime(), resolution and cost depend on the MPI library
+ *   - clock: clock_gettime(CLOCK_MONOTONIC_RAW)
+ *   - tsc:   rdtscp on x86 CPUs with an invariant TSC; the frequency is
+ *            calibrated against CLOCK_MONOTONIC_RAW by timer_select()
+ * timer_now() returns seconds like MPI_Wtime(). timer_elapsed() optionally
+ * subtracts the overhead of one timer read (see timer_calibrate()), but
+ * never returns less than zero. timer_calibrate() measures every available
+ * backend, so timer_print_calibration() can put them side by side.
+ */
+typedef enum _timer_backend_t {
+	TIMER_MPI = 0,
+	TIMER_CLOCK,
+	TIMER_TSC,
+	TIMER_NUM_BACKENDS
+} timer_backend_t;
+
+typedef struct _timer_calib_t {
+	double resolution;	/* smallest observed step in seconds */
+	double overhead;	/* median cost of a timer read in seconds */
+	double frequency;	/* ticks per second (tsc only) */
+	bool available;
+} timer_calib_t;
+
+extern timer_backend_t timer_backend;
+extern double timer_correction;
+extern double timer_tsc_period;
+extern uint64_t timer_tsc_base;
+extern time_t timer_clock_base;
+
+int
+timer_parse(const char *name,
+	    timer_backend_t *backend);
+
+const char *
+timer_name(timer_backend_t backend);
+
+int
+timer_select(timer_backend_t backend);
+
+void
+timer_calibrate(timer_calib_t *calib);
+
+void
+timer_subtract_overhead(const timer_calib_t *calib);
+
+void
+timer_print_calibration(FILE *output,
+			const char *label,
+			const char *indent);
+
+static inline double
+timer_now(void) {
+	struct timespec ts;
+#if defined(__x86_64__) || defined(__i386__)
+	unsigned int aux;
+#endif
+
+	switch (timer_backend) {
+		case TIMER_CLOCK:
+			clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+			return (ts.tv_sec-timer_clock_base) + ts.tv_nsec*1e-9;
+#if defined(__x86_64__) || defined(__i386__)
+		case TIMER_TSC:
+			return (__builtin_ia32_rdtscp(&aux)-timer_tsc_base) *
+			    timer_tsc_period;
+#endif
+		default:
+			return MPI_Wtime();
+	}
+}
+
+/*
+ * seconds since 'start' without the (optional) timer overhead; intervals
+ * shorter than the overhead are clamped to zero
+ */
+static inline double
+timer_elapsed(double start) {
+	double elapsed = timer_now()-start-timer_correction;
+
+	return (elapsed > 0) ? elapsed : 0;
+}
+
+#endif /* _TIMER_H */